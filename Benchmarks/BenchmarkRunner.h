@@ -0,0 +1,101 @@
+// Copyright 2018
+
+#ifndef BENCHMARKS_BENCHMARK_RUNNER_H_
+#define BENCHMARKS_BENCHMARK_RUNNER_H_
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "Utils.h"
+
+namespace Fatracing {
+
+//! Результат одного замера
+struct BenchmarkResult {
+	std::string Name;
+	//! Количество операций в замере
+	uint64_t Operations = 0;
+	//! Время замера, нс
+	double ElapsedNs = 0.0;
+
+	double NsPerOp() const { return Operations > 0 ? ElapsedNs / Operations : 0.0; }
+	double OpsPerSecond() const { return ElapsedNs > 0.0 ? Operations * 1e9 / ElapsedNs : 0.0; }
+};
+
+//! Минимальный набор замеров: фильтр по имени, прогрев, лучший из нескольких повторов,
+//! вывод таблицей в stderr и в JSON (для сравнения между коммитами)
+class BenchmarkRunner {
+	std::string mFilter;
+	int mRepetitions = 3;
+	std::vector<BenchmarkResult> mResults;
+
+public:
+	//! @param aFilter запускаются только замеры, в имени которых есть эта подстрока
+	//! @param aRepetitions количество повторов, в результат идёт лучший
+	BenchmarkRunner(const std::string& aFilter, int aRepetitions) :
+		mFilter(aFilter), mRepetitions(aRepetitions > 0 ? aRepetitions : 1) {}
+
+	bool IsSelected(const std::string& aName) const {
+		return mFilter.empty() || aName.find(mFilter) != std::string::npos;
+	}
+
+	//! Замер, который сам считает операции и время: aFunction() возвращает BenchmarkResult
+	//! с заполненными Operations и ElapsedNs
+	template <typename F>
+	void RunMeasured(const std::string& aName, F aFunction) {
+		if (!IsSelected(aName)) {
+			return;
+		}
+		BenchmarkResult best;
+		for (int i = 0; i < mRepetitions; ++i) {
+			BenchmarkResult result = aFunction();
+			if (i == 0 || result.NsPerOp() < best.NsPerOp()) {
+				best = result;
+			}
+		}
+		best.Name = aName;
+		std::fprintf(stderr, "%-48s %12.1f ns/op %14.0f ops/s\n", aName.c_str(), best.NsPerOp(), best.OpsPerSecond());
+		mResults.push_back(best);
+	}
+
+	//! Замер цикла: aFunction(i) вызывается aIterations раз
+	//! @param aOperationsPerCall сколько операций выполняет один вызов aFunction
+	template <typename F>
+	void Run(const std::string& aName, uint64_t aIterations, F aFunction, uint64_t aOperationsPerCall = 1) {
+		RunMeasured(aName, [&]() {
+			for (uint64_t i = 0; i < aIterations / 10; ++i) {
+				aFunction(i);
+			}
+			const auto start = std::chrono::steady_clock::now();
+			for (uint64_t i = 0; i < aIterations; ++i) {
+				aFunction(i);
+			}
+			BenchmarkResult result;
+			result.Operations = aIterations * aOperationsPerCall;
+			result.ElapsedNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+			return result;
+		});
+	}
+
+	//! Записать результаты в JSON
+	bool WriteJson(std::FILE* aFile) const {
+		std::fprintf(aFile, "{\n  \"benchmarks\": [\n");
+		for (size_t i = 0; i < mResults.size(); ++i) {
+			const BenchmarkResult& result = mResults[i];
+			std::fprintf(aFile,
+			             "    {\"name\": \"%s\", \"operations\": %llu, \"elapsed_ns\": %.0f, "
+			             "\"ns_per_op\": %.3f, \"ops_per_sec\": %.1f}%s\n",
+			             result.Name.c_str(), static_cast<unsigned long long>(result.Operations), result.ElapsedNs,
+			             result.NsPerOp(), result.OpsPerSecond(), i + 1 < mResults.size() ? "," : "");
+		}
+		std::fprintf(aFile, "  ]\n}\n");
+		return std::ferror(aFile) == 0;
+	}
+};
+
+} // namespace Fatracing
+
+#endif // BENCHMARKS_BENCHMARK_RUNNER_H_
@@ -0,0 +1,399 @@
+// Copyright 2018
+
+// Замеры горячих путей: разбор кадров, Race::BlackBoxCallback, воспроизведение журнала, AsyncQueue,
+// Logger::Log, Utils::Format (и прежняя реализация для сравнения), загрузка настроек, запись и чтение
+// сегментов сессии. Таблица пишется в stderr, результаты в JSON - в stdout или в файл (--json <file>),
+// чтобы сравнивать их между коммитами. Временные файлы создаются во временном каталоге системы.
+//
+// benchmarks [--filter <substring>] [--repetitions <n>] [--json <file>]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/filesystem/path.hpp>
+
+#include "AsyncQueue.h"
+#include "BinaryLog.h"
+#include "Logger.h"
+#include "Utils.h"
+
+#include "Savers/Defines.h"
+#include "Savers/SegmentFile.h"
+
+#include "BlackBox/FrameParser.h"
+#include "Core/Race.h"
+#include "Core/RaceReplay.h"
+#include "Core/Settings.h"
+
+#include "./BenchmarkRunner.h"
+
+using namespace Fatracing;
+
+namespace {
+
+//! Не даём компилятору выбросить результат
+volatile uint64_t gSink = 0;
+
+typedef std::chrono::steady_clock Clock;
+
+//! Путь для временного файла замера во временном каталоге системы (% - случайные символы)
+std::string ScratchPath(const char* aPattern) {
+	const boost::filesystem::path path = boost::filesystem::temp_directory_path() /
+	                                     boost::filesystem::unique_path(std::string("fatracing-bench-") + aPattern);
+	return path.string();
+}
+
+double ElapsedNs(Clock::time_point aStart) {
+	return std::chrono::duration<double, std::nano>(Clock::now() - aStart).count();
+}
+
+void BenchmarkFrameParser(BenchmarkRunner& aRunner) {
+	// 64 КБ кадров вперемешку по дорожкам, как их отдаёт read_some при высокой частоте
+	const size_t frameCount = 64 * 1024 / FrameParser::FrameSize;
+	std::vector<uint8_t> data;
+	data.reserve(frameCount * FrameParser::FrameSize);
+	for (size_t i = 0; i < frameCount; ++i) {
+		data.push_back(i % 2 ? 'r' : 'l');
+		data.push_back('\r');
+		data.push_back('\n');
+	}
+
+	aRunner.Run("FrameParser::Parse (frames, 64 KB reads)", 2000, [&](uint64_t) {
+		FrameParser parser;
+		uint64_t red = 0;
+		parser.Parse(data.data(), data.size(), [&](RacersEnum aRacer) {
+			red += aRacer == RacersEnum::RED;
+		});
+		gSink = gSink + red;
+	}, frameCount);
+
+	// тот же поток, порезанный на чтения по 7 байт (кадры рвутся между чтениями)
+	aRunner.Run("FrameParser::Parse (frames, 7-byte reads)", 2000, [&](uint64_t) {
+		FrameParser parser;
+		uint64_t red = 0;
+		for (size_t offset = 0; offset < data.size(); offset += 7) {
+			const size_t size = std::min<size_t>(7, data.size() - offset);
+			parser.Parse(data.data() + offset, size, [&](RacersEnum aRacer) {
+				red += aRacer == RacersEnum::RED;
+			});
+		}
+		gSink = gSink + red;
+	}, frameCount);
+}
+
+void BenchmarkRace(BenchmarkRunner& aRunner, size_t aLanes) {
+	// Race поддерживает две дорожки, поэтому N дорожек - это N потоков, подающих импульсы
+	// одновременно (как N отдельных чтений из порта), по дорожкам поровну
+	const uint64_t pulsesPerLane = 200000;
+	const std::string name = "Race::BlackBoxCallback (" + std::to_string(aLanes) + " lanes)";
+	aRunner.RunMeasured(name, [&]() {
+		SettingsStruct settings;
+		settings.RaceTimeSeconds = 60;
+		std::atomic<uint64_t> published{0};
+		Race race(settings, [&](const RaceSnapshot&) {
+			published.fetch_add(1, std::memory_order_relaxed);
+		});
+
+		std::atomic<bool> go{false};
+		std::vector<std::thread> lanes;
+		for (size_t lane = 0; lane < aLanes; ++lane) {
+			lanes.emplace_back([&, lane]() {
+				while (!go) {
+				}
+				const RacersEnum racer = lane % 2 ? RacersEnum::RED : RacersEnum::BLUE;
+				for (uint64_t i = 0; i < pulsesPerLane; ++i) {
+					race.BlackBoxCallback(racer, Clock::now());
+				}
+			});
+		}
+		const auto start = Clock::now();
+		go = true;
+		for (auto& lane : lanes) {
+			lane.join();
+		}
+		BenchmarkResult result;
+		result.Operations = pulsesPerLane * aLanes;
+		result.ElapsedNs = ElapsedNs(start);
+		gSink = gSink + published;
+		return result;
+	});
+}
+
+void BenchmarkReplay(BenchmarkRunner& aRunner) {
+	// синтетический журнал: 60-секундная гонка, по 5000 импульсов в секунду на дорожку
+	const int raceTime = 60;
+	const uint64_t pulsesPerSecond = 5000;
+	JournalHeader header = {};
+	header.RaceTimeSeconds = raceTime;
+	std::vector<JournalRecord> records;
+	JournalRecord start = {};
+	start.Type = JournalRecordType::Start;
+	records.push_back(start);
+	uint64_t scores[2] = {0, 0};
+	for (int second = 0; second < raceTime; ++second) {
+		for (uint64_t i = 0; i < 2 * pulsesPerSecond; ++i) {
+			JournalRecord pulse = {};
+			pulse.TimeNs = second * 1000000000LL + static_cast<int64_t>(i * 1000000000ULL / (2 * pulsesPerSecond));
+			pulse.Type = JournalRecordType::Pulse;
+			pulse.Lane = static_cast<uint8_t>(i % 2);
+			pulse.Value = static_cast<uint32_t>(++scores[i % 2]);
+			records.push_back(pulse);
+		}
+		JournalRecord tick = {};
+		tick.TimeNs = (second + 1) * 1000000000LL;
+		tick.Type = JournalRecordType::Tick;
+		tick.Lane = second + 1 == raceTime ? 1 : 0;
+		tick.Value = static_cast<uint32_t>(std::max(raceTime - second - 1, 0));
+		records.push_back(tick);
+	}
+
+	RaceReplay replay;
+	replay.Assign(header, records);
+	aRunner.RunMeasured("RaceReplay::Run (as fast as possible)", [&]() {
+		SettingsStruct settings = replay.GetSettings();
+		Race race(settings, [](const RaceSnapshot&) {});
+		const ReplayResult replayResult = replay.Run(race);
+		gSink = gSink + replayResult.Mismatches;
+		BenchmarkResult result;
+		result.Operations = replayResult.Pulses;
+		result.ElapsedNs = replayResult.ElapsedSeconds * 1e9;
+		return result;
+	});
+}
+
+class CountingQueue : public AsyncQueue<uint64_t> {
+public:
+	std::atomic<uint64_t> mHandled{0};
+
+protected:
+	void HandleWorkItem(std::shared_ptr<uint64_t> aItem) override {
+		gSink = gSink + *aItem;
+		mHandled.fetch_add(1, std::memory_order_relaxed);
+	}
+};
+
+void BenchmarkAsyncQueue(BenchmarkRunner& aRunner, size_t aProducers) {
+	const uint64_t itemsPerProducer = 100000;
+	const std::string name = "AsyncQueue push/pop (" + std::to_string(aProducers) + " producers)";
+	aRunner.RunMeasured(name, [&]() {
+		CountingQueue queue;
+		queue.StartThread();
+		const uint64_t total = itemsPerProducer * aProducers;
+
+		const auto start = Clock::now();
+		std::vector<std::thread> producers;
+		for (size_t p = 0; p < aProducers; ++p) {
+			producers.emplace_back([&]() {
+				for (uint64_t i = 0; i < itemsPerProducer; ++i) {
+					queue.AddItem(std::make_shared<uint64_t>(i));
+				}
+			});
+		}
+		for (auto& producer : producers) {
+			producer.join();
+		}
+		while (queue.mHandled < total) {
+			std::this_thread::yield();
+		}
+		BenchmarkResult result;
+		result.Operations = total;
+		result.ElapsedNs = ElapsedNs(start);
+		queue.StopThread();
+		return result;
+	});
+}
+
+void BenchmarkLogger(BenchmarkRunner& aRunner) {
+	Logger& logger = Logger::Instance();
+	const PriorityEnum level = logger.GetLogLevel();
+
+	// уровень отключён, только если он ниже и уровня лога, и уровня бортового самописца
+	logger.SetLogLevel(PriorityEnum::Info);
+	logger.SetFlightRecorderLevel(PriorityEnum::Info);
+	aRunner.Run("Logger::Log (disabled level)", 10000000, [](uint64_t i) {
+		LOGGER_LOG(PriorityEnum::Debug, "pulse %llu lane %d", static_cast<unsigned long long>(i), 1);
+	});
+	aRunner.Run("LOGGER_LOG_FAST (disabled level)", 10000000, [](uint64_t i) {
+		LOGGER_LOG_FAST(PriorityEnum::Debug, "pulse %llu lane %d", static_cast<unsigned long long>(i), 1);
+	});
+
+	logger.SetLogLevel(PriorityEnum::Trace);
+	logger.SetFlightRecorderLevel(PriorityEnum::Trace);
+	aRunner.Run("Logger::Log (enabled level)", 200000, [](uint64_t i) {
+		LOGGER_LOG(PriorityEnum::Info, "pulse %llu lane %d", static_cast<unsigned long long>(i), 1);
+	});
+	aRunner.Run("LOGGER_LOG_FAST (enabled level)", 200000, [](uint64_t i) {
+		LOGGER_LOG_FAST(PriorityEnum::Info, "pulse %llu lane %d", static_cast<unsigned long long>(i), 1);
+	});
+
+	logger.SetLogLevel(level);
+}
+
+//! Прежняя реализация Utils::Format (два прохода snprintf + буфер в куче), для сравнения
+template <typename... Args>
+std::string LegacyFormat(const char* format, Args&&... vs) {
+	char b;
+	unsigned int required = std::snprintf(&b, 0, format, vs...) + 1;
+
+	std::unique_ptr<char[]> bytes = std::unique_ptr<char[]>(new char[required]);
+	std::snprintf(bytes.get(), required, format, vs...);
+
+	return std::string(bytes.get());
+}
+
+//! Прежняя реализация Utils::Format(time_point)
+std::string LegacyFormatTime(const std::chrono::system_clock::time_point& time) {
+	auto tp = time.time_since_epoch();
+	tp -= std::chrono::duration_cast<std::chrono::seconds>(tp);
+
+	tm t = Utils::TimeToTimeT(time);
+	return LegacyFormat("[%04u-%02u-%02u %02u:%02u:%02u.%03u] ", t.tm_year + 1900,
+	                    t.tm_mon + 1, t.tm_mday, t.tm_hour, t.tm_min, t.tm_sec,
+	                    static_cast<unsigned int>(tp / std::chrono::milliseconds(1)));
+}
+
+void BenchmarkFormat(BenchmarkRunner& aRunner) {
+	aRunner.Run("LegacyFormat (short)", 2000000, [](uint64_t i) {
+		gSink = gSink + LegacyFormat("pulse %llu lane %d", static_cast<unsigned long long>(i), 1).size();
+	});
+	aRunner.Run("Utils::Format (short)", 2000000, [](uint64_t i) {
+		gSink = gSink + Utils::Format("pulse %llu lane %d", static_cast<unsigned long long>(i), 1).size();
+	});
+	aRunner.Run("Utils::FormatTo (short)", 2000000, [](uint64_t i) {
+		char buffer[64];
+		gSink = gSink + Utils::FormatTo(buffer, sizeof(buffer), "pulse %llu lane %d", static_cast<unsigned long long>(i), 1);
+	});
+	aRunner.Run("Utils::InlineString (short)", 2000000, [](uint64_t i) {
+		Utils::InlineString<64> s;
+		gSink = gSink + s.Format("pulse %llu lane %d", static_cast<unsigned long long>(i), 1).size();
+	});
+
+	const std::string longText(300, 'x');
+	aRunner.Run("LegacyFormat (long)", 1000000, [&](uint64_t i) {
+		gSink = gSink + LegacyFormat("%s %llu", longText.c_str(), static_cast<unsigned long long>(i)).size();
+	});
+	aRunner.Run("Utils::Format (long)", 1000000, [&](uint64_t i) {
+		gSink = gSink + Utils::Format("%s %llu", longText.c_str(), static_cast<unsigned long long>(i)).size();
+	});
+
+	const auto now = std::chrono::system_clock::now();
+	aRunner.Run("LegacyFormat (time_point)", 1000000, [&](uint64_t i) {
+		gSink = gSink + LegacyFormatTime(now + std::chrono::microseconds(i)).size();
+	});
+	aRunner.Run("Utils::Format (time_point)", 1000000, [&](uint64_t i) {
+		gSink = gSink + Utils::Format(now + std::chrono::microseconds(i)).size();
+	});
+	aRunner.Run("Utils::FormatTimestampTo", 1000000, [&](uint64_t i) {
+		char buffer[32];
+		gSink = gSink + Utils::FormatTimestampTo(buffer, sizeof(buffer), now + std::chrono::microseconds(i));
+	});
+}
+
+void BenchmarkSettings(BenchmarkRunner& aRunner) {
+	const std::string filePath = ScratchPath("settings-%%%%%%%%.xml");
+	const char* fileName = filePath.c_str();
+	if (!Utils::SaveContentsToFile(fileName,
+	                               "<?xml version=\"1.0\"?>\n"
+	                               "<GoldSprintsSettings>\n"
+	                               "    <RaceTimeSeconds>69</RaceTimeSeconds>\n"
+	                               "    <PortName>/dev/ttyACM0</PortName>\n"
+	                               "</GoldSprintsSettings>\n")) {
+		return;
+	}
+	Settings& settings = SettingsSingleton::Instance();
+	settings.SetFileName(fileName);
+	aRunner.Run("Settings::LoadSettings", 20000, [&](uint64_t) {
+		gSink = gSink + settings.LoadSettings();
+	});
+	std::remove(fileName);
+}
+
+void BenchmarkSegments(BenchmarkRunner& aRunner) {
+	// блоки RaceSession: 4096 записей журнала по 16 байт
+	const std::string filePath = ScratchPath("segment-%%%%%%%%.vms");
+	Data frame;
+	frame.time = std::chrono::system_clock::now();
+	frame.data.assign(4096 * sizeof(JournalRecord), 0x5A);
+
+	// сегмент не больше SegmentMaxSize, как у SessionSaver: на диске не больше одного сегмента
+	SegmentWriter writer;
+	uint64_t counter = 0;
+	aRunner.Run("SegmentWriter::Append (64 KB frame)", 1024, [&](uint64_t) {
+		if (writer.IsOpen() && writer.GetSize() + sizeof(SegmentRecordHeader) + frame.data.size() > SegmentMaxSize) {
+			writer.Close();
+		}
+		if (!writer.IsOpen()) {
+			counter = 0;
+			writer.Open(filePath, 1);
+		}
+		gSink = gSink + writer.Append(++counter, frame);
+	});
+	writer.Close();
+
+	SegmentReader reader;
+	if (reader.Open(filePath) && reader.GetCount() > 0) {
+		const uint64_t count = reader.GetCount();
+		Data data;
+		aRunner.Run("SegmentReader::Read (random counter)", 20000, [&](uint64_t i) {
+			// перемешанный порядок счётчиков: чтение не попадает в последовательный доступ
+			const uint64_t wanted = (i * 2654435761ULL) % count + 1;
+			gSink = gSink + (reader.Read(wanted, data) ? data.data.size() : 0);
+		});
+	}
+	reader.Close();
+	std::remove(filePath.c_str());
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+	std::string filter;
+	int repetitions = 3;
+	const char* jsonPath = nullptr;
+	for (int i = 1; i < argc; ++i) {
+		if (std::strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+			filter = argv[++i];
+		} else if (std::strcmp(argv[i], "--repetitions") == 0 && i + 1 < argc) {
+			repetitions = std::atoi(argv[++i]);
+		} else if (std::strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+			jsonPath = argv[++i];
+		} else {
+			std::fprintf(stderr, "Usage: %s [--filter <substring>] [--repetitions <n>] [--json <file>]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	BenchmarkRunner runner(filter, repetitions);
+	BenchmarkFrameParser(runner);
+	for (size_t lanes : {2, 4, 8}) {
+		BenchmarkRace(runner, lanes);
+	}
+	BenchmarkReplay(runner);
+	for (size_t producers : {1, 2, 4}) {
+		BenchmarkAsyncQueue(runner, producers);
+	}
+	BenchmarkLogger(runner);
+	BenchmarkFormat(runner);
+	BenchmarkSettings(runner);
+	BenchmarkSegments(runner);
+
+	std::FILE* json = jsonPath ? std::fopen(jsonPath, "w") : stdout;
+	if (!json) {
+		std::fprintf(stderr, "Cannot open %s\n", jsonPath);
+		return 1;
+	}
+	const bool written = runner.WriteJson(json);
+	if (jsonPath) {
+		std::fclose(json);
+	}
+	return written ? 0 : 1;
+}
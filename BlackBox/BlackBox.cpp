@@ -1,9 +1,23 @@
 #include "./BlackBox.h"
+#include "Trace.h"
+
+#ifndef _WIN32
+#include <poll.h>
+#endif
 
 
 namespace Fatracing {
 
-BlackBox::BlackBox(): mDummyWork(mIoService), mSerialPort(mIoService), mStopReadThread(false) {
+BlackBox::BlackBox():
+	mDummyWork(mIoService),
+	mSerialPort(mIoService),
+	mStopReadThread(false),
+	mPortOpenMetric(Metrics::Instance().AddCounter("fatracing_serial_opens_total",
+	                                               "Serial port opens, including reconnects")),
+	mReadErrorMetric(Metrics::Instance().AddCounter("fatracing_serial_read_errors_total",
+	                                                "Serial port read errors")),
+	mParseErrorMetric(Metrics::Instance().AddCounter("fatracing_parse_errors_total",
+	                                                 "Bytes skipped by the frame parser")) {
 	mBuffer.resize(512);
 }
 
@@ -54,6 +68,7 @@ bool BlackBox::Init(const SerialPortSettings& aSerialPortSettings) {
 	}
 
 	mSerialPortSettings = s;
+	mPortOpenMetric.Increment();
 
 	mStopReadThread = false;
     mReadThread = std::thread(std::bind(&BlackBox::ReadThreadFunc, this));
@@ -63,7 +78,7 @@ bool BlackBox::Init(const SerialPortSettings& aSerialPortSettings) {
 	return true;
 }
 
-void BlackBox::SetCallback(std::function<void (RacersEnum)> aCallback) {
+void BlackBox::SetCallback(Callback aCallback) {
     std::unique_lock<std::mutex> lock(mCallbackMutex);
     mCallback = aCallback;
 }
@@ -73,18 +88,47 @@ void BlackBox::ClearCallback() {
     mCallback = nullptr;
 }
 
+uint64_t BlackBox::GetFrameCount() const {
+    return mFrameCount;
+}
+
+uint64_t BlackBox::GetParseErrorCount() const {
+    return mParseErrorCount;
+}
+
+bool BlackBox::WaitReadable() {
+#ifndef _WIN32
+	// read_some не прерывается закрытием порта, поэтому ждём данные с таймаутом
+	// и между ожиданиями проверяем флаг остановки
+	pollfd pfd = {mSerialPort.native_handle(), POLLIN, 0};
+	return poll(&pfd, 1, ReadWaitTimeoutMs) != 0;
+#else
+	return true;
+#endif
+}
+
 void BlackBox::ReadThreadFunc() {
+	Tracer::Instance().SetThreadName("BlackBox");
 	while (mSerialPort.is_open()) {
 		if (mStopReadThread) {
 			return;
 		}
+		if (!WaitReadable()) {
+			continue;
+		}
 		boost::system::error_code err;
-		size_t bytesReceived = mSerialPort.read_some(boost::asio::buffer(mBuffer, mBuffer.size()), err);
+		size_t bytesReceived = 0;
+		{
+			TRACE_SCOPE("BlackBox", "SerialRead");
+			bytesReceived = mSerialPort.read_some(boost::asio::buffer(mBuffer, mBuffer.size()), err);
+		}
+		const auto arrivalTime = std::chrono::steady_clock::now();
 		if (err) {
 			if (mStopReadThread) {
 				return;
 			}
 			LOGGER_LOG(PriorityEnum::Error, "Не удалось прочитать данные из последовательного порта");
+			mReadErrorMetric.Increment();
 			mAreWeHappy = false;
 			return;
 		}
@@ -92,23 +136,19 @@ void BlackBox::ReadThreadFunc() {
 		std::unique_lock<std::mutex> lock(mLastReadTimeMutex);
 		mLastReadTime = std::chrono::system_clock::now();
 
-        Buffer data(mBuffer.begin(), mBuffer.begin() + bytesReceived);
-        if (data.size() == 3) {
-            RacersEnum racer;
-            bool success = false;
-            if (data[0] == 'r') {
-                racer = RacersEnum::RED;
-                success = true;
-            } else if (data[0] == 'l') {
-                racer = RacersEnum::BLUE;
-                success = true;
-            }
-            if (success) {
-                std::unique_lock<std::mutex> lock(mCallbackMutex);
-                if (mCallback) {
-                    mCallback(racer);
-                }
+        TRACE_SCOPE("BlackBox", "ParseFrame");
+        std::unique_lock<std::mutex> callbackLock(mCallbackMutex);
+        mParser.Parse(mBuffer.data(), bytesReceived, [&](RacersEnum racer) {
+            if (mCallback) {
+                mCallback(racer, arrivalTime);
             }
+        });
+        callbackLock.unlock();
+        mFrameCount = mParser.GetFrameCount();
+        const uint64_t parseErrors = mParser.GetErrorCount();
+        if (parseErrors != mParseErrorCount) {
+            mParseErrorMetric.Increment(parseErrors - mParseErrorCount);
+            mParseErrorCount = parseErrors;
         }
 
 	}
@@ -2,14 +2,19 @@
 #define TIME_FORMAT_UNIT_H_
 
 #include <stdint.h>
+#include <chrono>
+#include <functional>
 #include <thread>
 #include <mutex>
 
+#include <boost/asio/io_service.hpp>
 #include <boost/asio/serial_port.hpp>
 
 #include "../Core/Defines.h"
+#include "./FrameParser.h"
 
 #include "Logger.h"
+#include "Metrics.h"
 
 
 namespace Fatracing {
@@ -75,7 +80,7 @@ inline bool SetSerialPortSettings(boost::asio::serial_port& aSerialPort, const S
         aSerialPort.set_option(boost::asio::serial_port_base::flow_control(aSerialPortSettings.FlowControl));
     } catch (std::exception& e) {
         LOGGER_LOG(PriorityEnum::Error, "Не удалось установить настройки последовательного порта");
-        LOGGER_LOG(PriorityEnum::Error, e.what());
+        LOGGER_LOG(PriorityEnum::Error, "%s", e.what());
         return false;
     }
     return true;
@@ -83,8 +88,16 @@ inline bool SetSerialPortSettings(boost::asio::serial_port& aSerialPort, const S
 
 
 class BlackBox {
+public:
+    //! Обработчик импульса: гонщик и момент чтения данных из порта
+    typedef std::function<void(RacersEnum, std::chrono::steady_clock::time_point)> Callback;
+
+private:
     typedef std::vector<uint8_t> Buffer;
 
+    // Как часто поток чтения проверяет флаг остановки, мс
+    static const int ReadWaitTimeoutMs = 100;
+
     boost::asio::io_service mIoService;
     boost::asio::io_service::work mDummyWork;
     boost::asio::serial_port mSerialPort;
@@ -93,9 +106,17 @@ class BlackBox {
     bool mStopReadThread;
     std::thread mReadThread;
     Buffer mBuffer;
+    FrameParser mParser;
+    std::atomic<uint64_t> mFrameCount{0};
+    std::atomic<uint64_t> mParseErrorCount{0};
+
+    // Метрики: открытия порта (в том числе переподключения), ошибки чтения и разбора
+    MetricCounter& mPortOpenMetric;
+    MetricCounter& mReadErrorMetric;
+    MetricCounter& mParseErrorMetric;
 
     std::mutex mCallbackMutex;
-    std::function<void(RacersEnum)> mCallback;
+    Callback mCallback;
 
     std::chrono::system_clock::time_point mLastReadTime;
     std::mutex mLastReadTimeMutex;
@@ -108,14 +129,18 @@ public:
     ~BlackBox();
 
     bool Init(const SerialPortSettings& aSerialPortSettings);
-    void SetCallback(std::function<void(RacersEnum)> aCallback);
+    void SetCallback(Callback aCallback);
     void ClearCallback();
 
+    // Количество разобранных кадров и пропущенных при разборе байтов
+    uint64_t GetFrameCount() const;
+    uint64_t GetParseErrorCount() const;
+
 private:
+    // Дождаться данных в порту, false по таймауту
+    bool WaitReadable();
     void ReadThreadFunc();
     void ReOpenPortFunc();
-
-    static std::vector<Buffer> SplitPackets(Buffer data);
 };
 
 } // namespace Fatracing
@@ -0,0 +1,81 @@
+#ifndef FRAME_PARSER_H_
+#define FRAME_PARSER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../Core/Defines.h"
+
+
+namespace Fatracing {
+
+// Потоковый разбор кадров чёрного ящика.
+// Кадр - 3 байта, первый 'r' (красная дорожка) или 'l' (синяя), остальные два не проверяются
+// (коробка шлёт "r\r\n" / "l\r\n"). Кадры могут приходить склеенными или разорванными
+// между чтениями из порта: незаконченный кадр сохраняется до следующего вызова Parse.
+// Байты, с которых не может начинаться кадр, пропускаются и считаются ошибками разбора.
+class FrameParser {
+public:
+    static const size_t FrameSize = 3;
+
+private:
+    uint8_t mPartial[FrameSize];
+    size_t mPartialSize = 0;
+    uint64_t mFrameCount = 0;
+    uint64_t mErrorCount = 0;
+
+public:
+    // Разобрать очередную порцию данных, aOnFrame(RacersEnum) вызывается на каждый кадр
+    template <typename F>
+    void Parse(const uint8_t* aData, size_t aSize, F&& aOnFrame);
+
+    void Reset() { mPartialSize = 0; }
+
+    // Всего разобрано кадров
+    uint64_t GetFrameCount() const { return mFrameCount; }
+    // Всего пропущено байтов
+    uint64_t GetErrorCount() const { return mErrorCount; }
+
+private:
+    static bool IsFrameStart(uint8_t aByte) { return aByte == 'r' || aByte == 'l'; }
+    static RacersEnum Racer(uint8_t aByte) { return aByte == 'r' ? RacersEnum::RED : RacersEnum::BLUE; }
+};
+
+template <typename F>
+void FrameParser::Parse(const uint8_t* aData, size_t aSize, F&& aOnFrame) {
+    size_t i = 0;
+
+    // дописываем кадр, начатый в прошлом чтении
+    if (mPartialSize > 0) {
+        while (mPartialSize < FrameSize && i < aSize) {
+            mPartial[mPartialSize++] = aData[i++];
+        }
+        if (mPartialSize < FrameSize) {
+            return;
+        }
+        mPartialSize = 0;
+        ++mFrameCount;
+        aOnFrame(Racer(mPartial[0]));
+    }
+
+    while (i < aSize) {
+        if (!IsFrameStart(aData[i])) {
+            ++mErrorCount;
+            ++i;
+            continue;
+        }
+        if (aSize - i < FrameSize) {
+            while (i < aSize) {
+                mPartial[mPartialSize++] = aData[i++];
+            }
+            return;
+        }
+        ++mFrameCount;
+        aOnFrame(Racer(aData[i]));
+        i += FrameSize;
+    }
+}
+
+} // namespace Fatracing
+
+#endif // FRAME_PARSER_H_
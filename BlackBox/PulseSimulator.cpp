@@ -0,0 +1,164 @@
+#include "./PulseSimulator.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "Logger.h"
+#include "Trace.h"
+
+
+namespace Fatracing {
+
+namespace {
+const uint8_t LaneFrames[2][3] = {{'l', '\r', '\n'}, {'r', '\r', '\n'}};
+// Кадров в одной записи в свободном режиме
+const size_t FreeRunBatch = 256;
+// Сколько ждать готовности pty к записи, мс (чтобы вовремя заметить остановку)
+const int PollTimeoutMs = 100;
+}
+
+PulseSimulator::PulseSimulator() {
+    for (size_t i = 0; i < LaneCount; ++i) {
+        mRate[i] = 0.0;
+        mSent[i] = 0;
+    }
+}
+
+PulseSimulator::~PulseSimulator() {
+    Stop();
+    if (mMasterFd >= 0) {
+        close(mMasterFd);
+    }
+}
+
+bool PulseSimulator::Open() {
+    mMasterFd = posix_openpt(O_RDWR | O_NOCTTY);
+    if (mMasterFd < 0 || grantpt(mMasterFd) != 0 || unlockpt(mMasterFd) != 0) {
+        LOGGER_LOG(PriorityEnum::Error, "Не удалось создать псевдотерминал: errno %d", errno);
+        return false;
+    }
+    const char* name = ptsname(mMasterFd);
+    if (!name) {
+        LOGGER_LOG(PriorityEnum::Error, "Не удалось получить имя псевдотерминала: errno %d", errno);
+        return false;
+    }
+    mPortName = name;
+    return true;
+}
+
+void PulseSimulator::SetRate(RacersEnum aRacer, double aPulsesPerSecond) {
+    mRate[LaneIndex(aRacer)] = aPulsesPerSecond;
+}
+
+uint64_t PulseSimulator::GetSentCount(RacersEnum aRacer) const {
+    return mSent[LaneIndex(aRacer)];
+}
+
+bool PulseSimulator::Start() {
+    if (mMasterFd < 0) {
+        return false;
+    }
+    return StartThread();
+}
+
+void PulseSimulator::Stop() {
+    StopThread();
+}
+
+bool PulseSimulator::WriteAll(const uint8_t* aData, size_t aSize) {
+    while (aSize > 0) {
+        if (!IsThreadActive()) {
+            return false;
+        }
+        pollfd pfd = {mMasterFd, POLLOUT, 0};
+        const int ready = poll(&pfd, 1, PollTimeoutMs);
+        if (ready < 0 && errno != EINTR) {
+            return false;
+        }
+        if (ready <= 0) {
+            continue;
+        }
+        const ssize_t written = write(mMasterFd, aData, aSize);
+        if (written < 0) {
+            if (errno == EINTR || errno == EAGAIN) {
+                continue;
+            }
+            LOGGER_LOG(PriorityEnum::Error, "Ошибка записи в псевдотерминал: errno %d", errno);
+            return false;
+        }
+        aData += written;
+        aSize -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+void PulseSimulator::ThreadFunc() {
+    Tracer::Instance().SetThreadName("PulseSimulator");
+    bool paced = false;
+    for (size_t i = 0; i < LaneCount; ++i) {
+        paced = paced || mRate[i] > 0.0;
+    }
+    if (paced) {
+        RunPaced();
+    } else {
+        RunFreely();
+    }
+}
+
+void PulseSimulator::RunPaced() {
+    typedef std::chrono::steady_clock Clock;
+    const auto start = Clock::now();
+    std::array<uint64_t, LaneCount> due{};
+
+    while (IsThreadActive()) {
+        // сколько кадров каждой дорожки должно было уйти к этому моменту
+        const double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+        auto nextTime = Clock::now() + std::chrono::milliseconds(PollTimeoutMs);
+        for (size_t lane = 0; lane < LaneCount; ++lane) {
+            const double rate = mRate[lane];
+            if (rate <= 0.0) {
+                continue;
+            }
+            const uint64_t target = static_cast<uint64_t>(elapsed * rate);
+            while (due[lane] < target) {
+                if (!WriteAll(LaneFrames[lane], sizeof(LaneFrames[lane]))) {
+                    return;
+                }
+                ++due[lane];
+                ++mSent[lane];
+            }
+            const auto laneNext = start + std::chrono::duration_cast<Clock::duration>(
+                std::chrono::duration<double>((due[lane] + 1) / rate));
+            if (laneNext < nextTime) {
+                nextTime = laneNext;
+            }
+        }
+        std::this_thread::sleep_until(nextTime);
+    }
+}
+
+void PulseSimulator::RunFreely() {
+    std::vector<uint8_t> batch;
+    batch.reserve(FreeRunBatch * sizeof(LaneFrames[0]));
+    for (size_t i = 0; i < FreeRunBatch; ++i) {
+        const uint8_t* frame = LaneFrames[i % LaneCount];
+        batch.insert(batch.end(), frame, frame + sizeof(LaneFrames[0]));
+    }
+    while (IsThreadActive()) {
+        if (!WriteAll(batch.data(), batch.size())) {
+            return;
+        }
+        for (size_t lane = 0; lane < LaneCount; ++lane) {
+            mSent[lane] += FreeRunBatch / LaneCount;
+        }
+    }
+}
+
+} // namespace Fatracing
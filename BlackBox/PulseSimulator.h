@@ -0,0 +1,58 @@
+#ifndef PULSE_SIMULATOR_H_
+#define PULSE_SIMULATOR_H_
+
+#include <stdint.h>
+
+#include <array>
+#include <atomic>
+#include <string>
+
+#include "BaseThread.h"
+
+#include "../Core/Defines.h"
+
+
+namespace Fatracing {
+
+// Имитатор чёрного ящика на псевдотерминале (Linux).
+// Открывает пару pty, отдаёт имя подчинённой стороны, которое передаётся в BlackBox
+// вместо настоящего порта, и пишет в неё кадры "r\r\n" / "l\r\n" с заданной частотой по дорожкам.
+// При нулевой частоте у всех дорожек кадры пишутся так быстро, как их успевает читать BlackBox.
+class PulseSimulator : protected BaseThread {
+    static const size_t LaneCount = 2;
+
+    int mMasterFd = -1;
+    std::string mPortName;
+    std::array<std::atomic<double>, LaneCount> mRate;
+    std::array<std::atomic<uint64_t>, LaneCount> mSent;
+
+public:
+    PulseSimulator();
+    ~PulseSimulator();
+
+    // Создать pty, false при ошибке
+    bool Open();
+    // Имя подчинённой стороны pty для BlackBox
+    const std::string& GetPortName() const { return mPortName; }
+
+    // Частота импульсов дорожки, импульсов в секунду
+    void SetRate(RacersEnum aRacer, double aPulsesPerSecond);
+    // Сколько кадров отправлено по дорожке
+    uint64_t GetSentCount(RacersEnum aRacer) const;
+
+    bool Start();
+    void Stop();
+
+protected:
+    void ThreadFunc() override;
+
+private:
+    static size_t LaneIndex(RacersEnum aRacer) { return aRacer == RacersEnum::BLUE ? 0 : 1; }
+    bool WriteAll(const uint8_t* aData, size_t aSize);
+    void RunPaced();
+    void RunFreely();
+};
+
+} // namespace Fatracing
+
+#endif // PULSE_SIMULATOR_H_
@@ -0,0 +1,483 @@
+// Copyright 2018
+
+// Консольный запуск гонки без GUI.
+// Загружает GoldSprintsSettings.xml, запускает Race с BlackBox на настоящем порту или на
+// имитаторе (pty) и пишет каждое состояние гонки в stdout: построчным JSON или компактными
+// бинарными записями фиксированного размера (CliRecord). Итоги пишутся в stderr.
+//
+// Режимы:
+//   обычный          - --races N гонок по RaceTimeSeconds подряд
+//   --free-running   - гонка без таймера, импульсы считаются --duration секунд (замер пропускной
+//                      способности); с --simulate и без --rate имитатор шлёт кадры без пауз
+//   --replay <file>  - воспроизведение журналов гонок через Race на виртуальных часах
+//                      (--speed 0 - без пауз, 1 - в реальном времени); код возврата 1, если
+//                      результат хотя бы одной гонки разошёлся с журналом
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "BoundedQueue.h"
+#include "Logger.h"
+#include "Metrics.h"
+#include "MetricsServer.h"
+#include "Utils.h"
+
+#include "../BlackBox/PulseSimulator.h"
+#include "../Core/Race.h"
+#include "../Core/RaceReplay.h"
+#include "../Core/Settings.h"
+
+using namespace Fatracing;
+
+namespace {
+
+enum class OutputFormat {
+    Json,
+    Binary,
+    None
+};
+
+struct CliOptions {
+    const char* SettingsPath = "GoldSprintsSettings.xml";
+    std::string PortName;
+    int RaceTimeSeconds = -1;
+    double RaceDistanceMeters = -1.0;
+    int CountdownSeconds = -1;
+    int FalseStartThresholdMs = -1;
+    int Races = 1;
+    bool FreeRunning = false;
+    double DurationSeconds = 10.0;
+    bool Simulate = false;
+    double BlueRate = -1.0;
+    double RedRate = -1.0;
+    OutputFormat Format = OutputFormat::Json;
+    const char* MetricsAddress = nullptr;
+    const char* JournalDirectory = nullptr;
+    const char* SessionDirectory = nullptr;
+    std::vector<std::string> ReplayPaths;
+    double ReplaySpeed = 0.0;
+};
+
+// Бинарная запись состояния, little-endian, 48 байт
+#pragma pack(push, 1)
+struct CliRecord {
+    // время события от сигнала старта, мкс (RaceStruct::EventTimeUs)
+    int64_t TimeUs;
+    int32_t Seconds;
+    // бит 0 - финиш, бит 1 - лидирует красный, бит 2 - результаты фотофиниша окончательные
+    uint32_t Flags;
+    uint64_t BlueScore;
+    uint64_t RedScore;
+    uint64_t BlueRPM;
+    uint64_t RedRPM;
+};
+#pragma pack(pop)
+
+static_assert(sizeof(CliRecord) == 48, "CliRecord layout");
+
+// Очередь между потоками гонки и потоком вывода
+const size_t OutputQueueSize = 1 << 16;
+// Буфер stdout
+const size_t OutputBufferSize = 1 << 20;
+// Частота имитатора по умолчанию в обычном режиме, импульсов в секунду
+const double DefaultSimulatorRate = 10.0;
+
+std::atomic<bool> gStop{false};
+
+void OnSignal(int) {
+    gStop = true;
+}
+
+void PrintUsage(const char* aProgram) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  --settings <file>     settings file (default GoldSprintsSettings.xml)\n"
+            "  --port <name>         serial port, overrides PortName from settings\n"
+            "  --race-time <sec>     overrides RaceTimeSeconds from settings (timeout in distance mode)\n"
+            "  --distance <m>        distance race, overrides RaceDistanceMeters from settings (0 - timed race)\n"
+            "  --countdown <sec>     start countdown, overrides CountdownSeconds from settings\n"
+            "  --false-start <ms>    false start threshold, overrides FalseStartThresholdMs from settings\n"
+            "  --races <n>           number of back-to-back races (default 1)\n"
+            "  --free-running        no race timer, count pulses for --duration seconds\n"
+            "  --duration <sec>      free-running duration (default 10)\n"
+            "  --simulate            use a built-in pty pulse simulator instead of a port\n"
+            "  --rate <pps>          simulator pulses per second for both lanes\n"
+            "  --blue-rate <pps>     simulator pulses per second, blue lane\n"
+            "  --red-rate <pps>      simulator pulses per second, red lane\n"
+            "  --format json|binary|none   stdout format (default json)\n"
+            "  --replay <file>...    replay race journals instead of racing\n"
+            "  --speed <x>           replay speed: 0 - as fast as possible (default), 1 - real time\n"
+            "  --journal <dir>       write race journals to <dir>, overrides JournalDirectory from settings\n"
+            "  --session <dir>       record the session log and race data under <dir>, overrides SessionDirectory\n"
+            "  --metrics <address>   serve Prometheus metrics on <port>, 127.0.0.1:<port> or unix:<path>\n",
+            aProgram);
+}
+
+bool ParseOptions(int argc, char* argv[], CliOptions& aOptions) {
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (strcmp(arg, "--settings") == 0 && hasValue) {
+            aOptions.SettingsPath = argv[++i];
+        } else if (strcmp(arg, "--port") == 0 && hasValue) {
+            aOptions.PortName = argv[++i];
+        } else if (strcmp(arg, "--race-time") == 0 && hasValue) {
+            aOptions.RaceTimeSeconds = atoi(argv[++i]);
+        } else if (strcmp(arg, "--distance") == 0 && hasValue) {
+            aOptions.RaceDistanceMeters = atof(argv[++i]);
+        } else if (strcmp(arg, "--countdown") == 0 && hasValue) {
+            aOptions.CountdownSeconds = atoi(argv[++i]);
+        } else if (strcmp(arg, "--false-start") == 0 && hasValue) {
+            aOptions.FalseStartThresholdMs = atoi(argv[++i]);
+        } else if (strcmp(arg, "--races") == 0 && hasValue) {
+            aOptions.Races = atoi(argv[++i]);
+        } else if (strcmp(arg, "--free-running") == 0) {
+            aOptions.FreeRunning = true;
+        } else if (strcmp(arg, "--duration") == 0 && hasValue) {
+            aOptions.DurationSeconds = atof(argv[++i]);
+        } else if (strcmp(arg, "--simulate") == 0) {
+            aOptions.Simulate = true;
+        } else if (strcmp(arg, "--rate") == 0 && hasValue) {
+            aOptions.BlueRate = aOptions.RedRate = atof(argv[++i]);
+        } else if (strcmp(arg, "--blue-rate") == 0 && hasValue) {
+            aOptions.BlueRate = atof(argv[++i]);
+        } else if (strcmp(arg, "--red-rate") == 0 && hasValue) {
+            aOptions.RedRate = atof(argv[++i]);
+        } else if (strcmp(arg, "--format") == 0 && hasValue) {
+            const char* format = argv[++i];
+            if (strcmp(format, "json") == 0) {
+                aOptions.Format = OutputFormat::Json;
+            } else if (strcmp(format, "binary") == 0) {
+                aOptions.Format = OutputFormat::Binary;
+            } else if (strcmp(format, "none") == 0) {
+                aOptions.Format = OutputFormat::None;
+            } else {
+                return false;
+            }
+        } else if (strcmp(arg, "--replay") == 0 && hasValue) {
+            aOptions.ReplayPaths.push_back(argv[++i]);
+        } else if (strcmp(arg, "--speed") == 0 && hasValue) {
+            aOptions.ReplaySpeed = atof(argv[++i]);
+        } else if (strcmp(arg, "--journal") == 0 && hasValue) {
+            aOptions.JournalDirectory = argv[++i];
+        } else if (strcmp(arg, "--session") == 0 && hasValue) {
+            aOptions.SessionDirectory = argv[++i];
+        } else if (strcmp(arg, "--metrics") == 0 && hasValue) {
+            aOptions.MetricsAddress = argv[++i];
+        } else if (arg[0] != '-' && !aOptions.ReplayPaths.empty()) {
+            // --replay a.frj b.frj ...
+            aOptions.ReplayPaths.push_back(arg);
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Поток вывода: забирает снимки из очереди и пишет их в stdout
+class OutputWriter : protected BaseThread {
+    OutputFormat mFormat;
+    BoundedQueue<RaceSnapshot> mQueue{OutputQueueSize};
+    std::atomic<uint64_t> mWritten{0};
+    std::atomic<uint64_t> mDropped{0};
+
+public:
+    explicit OutputWriter(OutputFormat aFormat) :
+        mFormat(aFormat) {
+        StartThread();
+    }
+
+    ~OutputWriter() {
+        Stop();
+    }
+
+    // Вызывается на потоках гонки, не блокируется
+    void Push(const RaceSnapshot& aSnapshot) {
+        if (mFormat == OutputFormat::None) {
+            return;
+        }
+        if (!mQueue.TryPush(aSnapshot)) {
+            ++mDropped;
+        }
+    }
+
+    // Дописать очередь и остановиться
+    void Stop() {
+        StopThread();
+        Drain();
+        fflush(stdout);
+    }
+
+    uint64_t GetWrittenCount() const { return mWritten; }
+    uint64_t GetDroppedCount() const { return mDropped; }
+    size_t GetQueueSize() const { return mQueue.Size(); }
+
+protected:
+    void ThreadFunc() override {
+        while (IsThreadActive()) {
+            if (Drain() == 0) {
+                fflush(stdout);
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+    }
+
+private:
+    size_t Drain() {
+        size_t count = 0;
+        RaceSnapshot snapshot;
+        while (mQueue.TryPop(snapshot)) {
+            Write(*snapshot);
+            snapshot.reset();
+            ++count;
+        }
+        mWritten += count;
+        return count;
+    }
+
+    // Результат и статистика дорожки в JSON
+    static size_t FormatLane(char* aBuffer, size_t aSize, const char* aName,
+                             const LaneResult& aResult, const LaneStats& aStats, const LaneStart& aStart) {
+        size_t size = Utils::FormatTo(aBuffer, aSize,
+            "\"%s\":{\"distance\":%.6f,\"meters\":%.4f,\"finish_us\":%lld,\"place\":%d,"
+            "\"false_start\":%s,\"reaction_us\":%lld,"
+            "\"top_speed\":%.3f,\"avg_speed\":%.3f,\"speed_sd\":%.3f,\"speed_cv\":%.4f,\"peak_rpm\":%.1f,"
+            "\"splits_us\":[",
+            aName, aResult.Distance, aResult.Meters, static_cast<long long>(aResult.FinishTimeUs), aResult.Place,
+            aStart.FalseStart ? "true" : "false", static_cast<long long>(aStart.ReactionUs),
+            aStats.TopSpeedMps, aStats.AverageSpeedMps, aStats.SpeedStdDevMps, aStats.SpeedCv, aStats.PeakCadenceRpm);
+        for (size_t i = 0; i < aStats.SplitCount; ++i) {
+            size += Utils::FormatTo(aBuffer + size, aSize - size, i == 0 ? "%lld" : ",%lld",
+                                    static_cast<long long>(aStats.SplitUs[i]));
+        }
+        size += Utils::FormatTo(aBuffer + size, aSize - size, "]}");
+        return size;
+    }
+
+    void Write(const RaceStruct& aRaceStruct) {
+        // время самого события, а не момента записи: очередь вывода может отставать
+        const int64_t timeUs = aRaceStruct.EventTimeUs;
+        const bool redLeads = aRaceStruct.Leader == RacersEnum::RED;
+        if (mFormat == OutputFormat::Json) {
+            char line[2048];
+            size_t size = Utils::FormatTo(line, sizeof(line),
+                "{\"t\":%lld,\"countdown\":%d,\"seconds\":%d,\"blue\":%llu,\"red\":%llu,\"blue_rpm\":%llu,\"red_rpm\":%llu,"
+                "\"leader\":\"%s\",\"diff\":%.3f,\"finish\":%s",
+                static_cast<long long>(timeUs), aRaceStruct.Countdown, aRaceStruct.Seconds,
+                static_cast<unsigned long long>(aRaceStruct.BlueScore),
+                static_cast<unsigned long long>(aRaceStruct.RedScore),
+                static_cast<unsigned long long>(aRaceStruct.BlueRPM),
+                static_cast<unsigned long long>(aRaceStruct.RedRPM),
+                redLeads ? "red" : "blue",
+                aRaceStruct.Diff,
+                aRaceStruct.Finish ? "true" : "false");
+            if (aRaceStruct.ResultsFinal) {
+                size += Utils::FormatTo(line + size, sizeof(line) - size, ",\"results\":{");
+                for (size_t lane = 0; lane < aRaceStruct.Results.size(); ++lane) {
+                    size += FormatLane(line + size, sizeof(line) - size, lane == 0 ? "blue" : "red",
+                                       aRaceStruct.Results[lane], aRaceStruct.Stats[lane], aRaceStruct.Starts[lane]);
+                    if (lane + 1 < aRaceStruct.Results.size()) {
+                        size += Utils::FormatTo(line + size, sizeof(line) - size, ",");
+                    }
+                }
+                size += Utils::FormatTo(line + size, sizeof(line) - size, "}");
+            }
+            size += Utils::FormatTo(line + size, sizeof(line) - size, "}\n");
+            fwrite(line, 1, size, stdout);
+        } else {
+            CliRecord record;
+            record.TimeUs = timeUs;
+            record.Seconds = aRaceStruct.Seconds;
+            record.Flags = (aRaceStruct.Finish ? 1u : 0u) | (redLeads ? 2u : 0u) | (aRaceStruct.ResultsFinal ? 4u : 0u);
+            record.BlueScore = aRaceStruct.BlueScore;
+            record.RedScore = aRaceStruct.RedScore;
+            record.BlueRPM = aRaceStruct.BlueRPM;
+            record.RedRPM = aRaceStruct.RedRPM;
+            fwrite(&record, sizeof(record), 1, stdout);
+        }
+    }
+};
+
+bool WaitFor(std::chrono::steady_clock::time_point aDeadline) {
+    while (!gStop && std::chrono::steady_clock::now() < aDeadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return !gStop;
+}
+
+// Воспроизвести журналы по очереди, false если хотя бы один не прочитан или разошёлся с записью
+bool RunReplay(const CliOptions& aOptions, OutputWriter& aWriter) {
+    bool ok = true;
+    uint64_t totalPulses = 0;
+    double totalSeconds = 0.0;
+    for (const auto& path : aOptions.ReplayPaths) {
+        if (gStop) {
+            break;
+        }
+        RaceReplay replay;
+        if (!replay.Load(path)) {
+            fprintf(stderr, "%s: cannot read journal\n", path.c_str());
+            ok = false;
+            continue;
+        }
+        replay.SetSpeed(aOptions.ReplaySpeed);
+        replay.SetStopFlag(&gStop);
+        auto settings = replay.GetSettings();
+        Race race(settings, [&](const RaceSnapshot& aSnapshot) {
+            aWriter.Push(aSnapshot);
+        });
+        const ReplayResult result = replay.Run(race);
+        totalPulses += result.Pulses;
+        totalSeconds += result.ElapsedSeconds;
+        fprintf(stderr, "%s: blue %llu red %llu, pulses %llu ticks %llu, mismatches %llu%s, %.3f s\n",
+                path.c_str(),
+                static_cast<unsigned long long>(result.Final->BlueScore),
+                static_cast<unsigned long long>(result.Final->RedScore),
+                static_cast<unsigned long long>(result.Pulses),
+                static_cast<unsigned long long>(result.Ticks),
+                static_cast<unsigned long long>(result.Mismatches),
+                result.Truncated ? ", no finish" : "",
+                result.ElapsedSeconds);
+        ok = ok && result.Mismatches == 0;
+    }
+    fprintf(stderr, "replayed %zu journals, %llu pulses, %.0f pulses/s\n",
+            aOptions.ReplayPaths.size(), static_cast<unsigned long long>(totalPulses),
+            totalSeconds > 0.0 ? totalPulses / totalSeconds : 0.0);
+    return ok;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    CliOptions options;
+    if (!ParseOptions(argc, argv, options)) {
+        PrintUsage(argv[0]);
+        return 2;
+    }
+
+    signal(SIGINT, OnSignal);
+    signal(SIGTERM, OnSignal);
+    Logger::Instance().InstallCrashHandlers();
+
+    if (!options.ReplayPaths.empty()) {
+        setvbuf(stdout, nullptr, _IOFBF, OutputBufferSize);
+        OutputWriter writer(options.Format);
+        return RunReplay(options, writer) ? 0 : 1;
+    }
+
+    auto& settingsSingleton = SettingsSingleton::Instance();
+    settingsSingleton.SetFileName(options.SettingsPath);
+    const bool settingsLoaded = settingsSingleton.LoadSettings();
+    auto settings = settingsSingleton.GetSettings();
+    if (!settingsLoaded && (options.RaceTimeSeconds < 0 || (options.PortName.empty() && !options.Simulate))) {
+        fprintf(stderr, "Cannot load settings from %s\n", options.SettingsPath);
+        return 1;
+    }
+    if (options.RaceTimeSeconds >= 0) {
+        settings.RaceTimeSeconds = options.RaceTimeSeconds;
+    }
+    if (options.RaceDistanceMeters >= 0.0) {
+        settings.RaceDistanceMeters = options.RaceDistanceMeters;
+    }
+    if (options.CountdownSeconds >= 0) {
+        settings.CountdownSeconds = options.CountdownSeconds;
+    }
+    if (options.FalseStartThresholdMs >= 0) {
+        settings.FalseStartThresholdMs = options.FalseStartThresholdMs;
+    }
+    if (!options.PortName.empty()) {
+        settings.PortName = options.PortName;
+    }
+    if (options.JournalDirectory) {
+        settings.JournalDirectory = options.JournalDirectory;
+    }
+    if (options.SessionDirectory) {
+        settings.SessionDirectory = options.SessionDirectory;
+    }
+
+    PulseSimulator simulator;
+    if (options.Simulate) {
+        if (!simulator.Open()) {
+            fprintf(stderr, "Cannot open pty simulator\n");
+            return 1;
+        }
+        settings.PortName = simulator.GetPortName();
+        // в свободном режиме без явной частоты имитатор работает без пауз
+        const double defaultRate = options.FreeRunning ? 0.0 : DefaultSimulatorRate;
+        simulator.SetRate(RacersEnum::BLUE, options.BlueRate >= 0.0 ? options.BlueRate : defaultRate);
+        simulator.SetRate(RacersEnum::RED, options.RedRate >= 0.0 ? options.RedRate : defaultRate);
+    }
+
+    setvbuf(stdout, nullptr, _IOFBF, OutputBufferSize);
+    const auto startTime = std::chrono::steady_clock::now();
+    OutputWriter writer(options.Format);
+
+    Race race(settings, [&](const RaceSnapshot& aSnapshot) {
+        writer.Push(aSnapshot);
+    });
+    race.Init();
+
+    // сервер объявлен после writer и race: останавливается раньше, чем они разрушаются
+    MetricsServer metricsServer;
+    if (options.MetricsAddress) {
+        Metrics& metrics = Metrics::Instance();
+        metrics.RegisterProcessMetrics();
+        metrics.AddCallback("fatracing_output_queue_depth", "Race states waiting to be written to stdout", false,
+                            [&writer]() { return static_cast<double>(writer.GetQueueSize()); });
+        metrics.AddCallback("fatracing_output_dropped_total", "Race states dropped because the output queue was full",
+                            true, [&writer]() { return static_cast<double>(writer.GetDroppedCount()); });
+        if (!metricsServer.Start(options.MetricsAddress)) {
+            fprintf(stderr, "Cannot serve metrics on %s\n", options.MetricsAddress);
+            return 1;
+        }
+    }
+
+    if (options.Simulate) {
+        simulator.Start();
+    }
+
+    if (options.FreeRunning) {
+        WaitFor(startTime + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(options.DurationSeconds)));
+    } else {
+        for (int i = 0; i < options.Races && !gStop; ++i) {
+            race.Start();
+            // гонка закончена, когда известны результаты фотофиниша; последний снимок берётся
+            // у Race, а не из обратного вызова, куда снимки предыдущей гонки могут прийти позже
+            while (!gStop && !race.GetSnapshot()->ResultsFinal) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+        }
+    }
+
+    simulator.Stop();
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    const auto snapshot = race.GetSnapshot();
+    writer.Stop();
+
+    const uint64_t received = snapshot ? snapshot->BlueScore + snapshot->RedScore : 0;
+    fprintf(stderr, "elapsed %.3f s, last race pulses blue %llu red %llu",
+            elapsed,
+            static_cast<unsigned long long>(snapshot ? snapshot->BlueScore : 0),
+            static_cast<unsigned long long>(snapshot ? snapshot->RedScore : 0));
+    if (options.FreeRunning) {
+        fprintf(stderr, ", %.0f pulses/s", elapsed > 0.0 ? received / elapsed : 0.0);
+    }
+    if (options.Simulate) {
+        fprintf(stderr, ", simulator sent blue %llu red %llu",
+                static_cast<unsigned long long>(simulator.GetSentCount(RacersEnum::BLUE)),
+                static_cast<unsigned long long>(simulator.GetSentCount(RacersEnum::RED)));
+    }
+    fprintf(stderr, ", states written %llu dropped %llu\n",
+            static_cast<unsigned long long>(writer.GetWrittenCount()),
+            static_cast<unsigned long long>(writer.GetDroppedCount()));
+    return 0;
+}
@@ -4,6 +4,7 @@
 #define COMMON_ASYNC_QUEUE_H_
 
 #include "BaseThread.h"
+#include <memory>
 #include <queue>
 #include <mutex>
 #include <condition_variable>
@@ -15,6 +16,7 @@ namespace Fatracing
     class AsyncQueue : public BaseThread
     {
         std::atomic<bool> mStopQueue {false};
+        std::atomic<uint64_t> mDroppedCount {0};
         std::queue<std::shared_ptr<T>> m_queue;
         std::mutex m_queueMutex;
         std::condition_variable mNotify;
@@ -33,6 +35,10 @@ namespace Fatracing
         bool AddItem(T* aItem, size_t aMaxQueueSize = 0);
 
         void ClearQueue();
+        /// number of items waiting in queue
+        size_t GetQueueSize();
+        /// number of items dropped because of aMaxQueueSize
+        uint64_t GetDroppedCount() const;
         virtual bool StartThread() override;
         virtual void StopThread() override;
 
@@ -67,6 +73,7 @@ namespace Fatracing
             while (m_queue.size() > requiredQueueSize)
             {
                 m_queue.pop();
+                ++mDroppedCount;
             }
         }
 
@@ -85,6 +92,7 @@ namespace Fatracing
 
             if (m_queue.size() > requiredQueueSize)
             {
+                ++mDroppedCount;
                 return false;
             }
         }
@@ -107,6 +115,19 @@ namespace Fatracing
         m_queue = std::queue<std::shared_ptr<T>>();
     }
 
+    template<class T>
+    inline size_t AsyncQueue<T>::GetQueueSize()
+    {
+        std::unique_lock<std::mutex> lock(m_queueMutex);
+        return m_queue.size();
+    }
+
+    template<class T>
+    inline uint64_t AsyncQueue<T>::GetDroppedCount() const
+    {
+        return mDroppedCount;
+    }
+
     template<class T>
     inline void AsyncQueue<T>::ThreadFunc()
     {
@@ -9,13 +9,15 @@
 
 #include "Logger.h"
 
-#include <QXmlStreamReader>
-#include <QXmlStreamWriter>
-#include <QFile>
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/xml_parser.hpp>
 
 
 namespace Fatracing {
 
+//! Дерево настроек (XML читается и пишется через boost::property_tree, без Qt)
+typedef boost::property_tree::ptree SettingsTree;
+
 //! Базовый класс настроек
 template <class T>
 class BaseSettings {
@@ -47,11 +49,11 @@ public:
 protected:
 	//! Получение настроек из XML 
 	//! @param aSettings корневой элемент XML
-	virtual T Parse(QXmlStreamReader& aSettings) = 0;
+	virtual T Parse(const SettingsTree& aSettings) = 0;
 	//! Сохранение настроек в файл
 	//! @param aRoot корневой элемент XML
 	//! @param aSettings структура с настройками
-	virtual void Save(QXmlStreamWriter& aRoot, const T& aSettings) = 0;
+	virtual void Save(SettingsTree& aRoot, const T& aSettings) = 0;
 
 public:
 	//! Загрузить настройки из файла
@@ -87,29 +89,24 @@ void BaseSettings<T>::SetFileName(const char* aFileName) {
 template <class T>
 inline bool
 BaseSettings<T>::LoadSettings() {
-	QXmlStreamReader xml;
-	auto fileContent = Utils::GetFileContents(mFileName);
-	if (fileContent.empty()) {
+	SettingsTree tree;
+	try {
+		boost::property_tree::read_xml(mFileName, tree, boost::property_tree::xml_parser::trim_whitespace);
+	} catch (std::exception& e) {
+		LOGGER_LOG(PriorityEnum::Error, "Не удалось прочитать настройки из %s: %s", mFileName, e.what());
 		return false;
 	}
-	xml.addData(fileContent.c_str());
-
-	while (!xml.atEnd()) {
-		xml.readNextStartElement();
-		if (xml.name() == QString::fromStdString(mSettingsRoot)) {
-			xml.readNextStartElement();
-			T settings = Parse(xml);
-			std::lock_guard<std::recursive_mutex> lock(mSettingsMutex);
-			mSettings = settings;
-			return true;
-		}
-	}
 
-	if (xml.hasError()) {
-		// TODO: error handling
+	auto root = tree.get_child_optional(mSettingsRoot);
+	if (!root) {
+		LOGGER_LOG(PriorityEnum::Error, "В файле %s нет элемента %s", mFileName, mSettingsRoot);
+		return false;
 	}
 
-	return false;
+	T settings = Parse(*root);
+	std::lock_guard<std::recursive_mutex> lock(mSettingsMutex);
+	mSettings = settings;
+	return true;
 }
 
 template <class T>
@@ -121,19 +118,18 @@ BaseSettings<T>::SaveSettings() {
 		settings = mSettings;
 	}
 
-	QFile file(mFileName);
-	file.open(QIODevice::WriteOnly);
+	SettingsTree root;
+	Save(root, settings);
+	SettingsTree tree;
+	tree.add_child(mSettingsRoot, root);
 
-	QXmlStreamWriter xml(&file);
-	xml.setAutoFormatting(true);
-
-	xml.writeStartDocument();
-	xml.writeStartElement(QString::fromStdString(mSettingsRoot));
-
-	Save(xml, settings);
-
-	xml.writeEndElement();
-	xml.writeEndDocument();
+	try {
+		boost::property_tree::write_xml(mFileName, tree, std::locale(),
+			boost::property_tree::xml_writer_make_settings<std::string>(' ', 4));
+	} catch (std::exception& e) {
+		LOGGER_LOG(PriorityEnum::Error, "Не удалось сохранить настройки в %s: %s", mFileName, e.what());
+		return false;
+	}
 
 	return true;
 }
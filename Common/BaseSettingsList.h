@@ -6,8 +6,7 @@
 #include <map>
 #include <mutex>
 
-#include <QXmlStreamReader>
-#include <QFile>
+#include "BaseSettings.h"
 #include "Utils.h"
 
 
@@ -28,8 +27,8 @@ protected:
     BaseSettingsList() = default;
     BaseSettingsList(const std::string& aFileName, const std::string& aSettingsRoot, const std::string& aElementName);
 
-    virtual T ParseElement(QXmlStreamReader& xml) = 0;
-    virtual void Save(QXmlStreamWriter& xml, const T& aElement) = 0;
+    virtual T ParseElement(const SettingsTree& aElement) = 0;
+    virtual void Save(SettingsTree& aElement, const T& aInfo) = 0;
     virtual bool SaveSettings(const std::map<unsigned int, T>& aSettings);
 
 public:
@@ -67,43 +66,35 @@ template <typename T>
 inline bool
 BaseSettingsList<T>::LoadSettings()
 {
-    bool settingsRead = false;
     std::map<unsigned int, T> settings;
-    {      
+    {
         std::lock_guard<std::mutex> lock(mSettingsFileMutex);
 
-        QXmlStreamReader xml;
-        auto fileContent = Utils::GetFileContents(mFileName.c_str());
-        xml.addData(fileContent.c_str());
-       
-        while (!xml.atEnd()) {
-            xml.readNextStartElement();
-            if (xml.name() == QString::fromStdString(mSettingsRoot)) {
-			    xml.readNextStartElement();
-                if (xml.name() == QString::fromStdString(mElementName)) {
-                    auto attributes =xml.attributes();
-                    if (attributes.hasAttribute("id")) {
-                        unsigned int id = attributes.value("id").toUInt();
-                        settings[id] = ParseElement(xml);
-                    }
+        SettingsTree tree;
+        try {
+            boost::property_tree::read_xml(mFileName, tree, boost::property_tree::xml_parser::trim_whitespace);
+        } catch (std::exception& e) {
+            LOGGER_LOG(PriorityEnum::Error, "Не удалось прочитать настройки из %s: %s", mFileName.c_str(), e.what());
+            return false;
+        }
+
+        auto root = tree.get_child_optional(mSettingsRoot);
+        if (root) {
+            for (const auto& node : *root) {
+                if (node.first != mElementName) {
+                    continue;
+                }
+                auto id = node.second.get_optional<unsigned int>("<xmlattr>.id");
+                if (id) {
+                    settings[*id] = ParseElement(node.second);
                 }
             }
         }
-        
-        
-        if (xml.hasError()) {
-            // TODO: error handling
-        }
-
-        settingsRead = true;
     }
 
-    if (settingsRead) {
-        std::lock_guard<std::mutex> lock(mSettingsMutex);
-        mSettings = settings;
-        return true;
-    }
-    return false;
+    std::lock_guard<std::mutex> lock(mSettingsMutex);
+    mSettings = settings;
+    return true;
 }
 
 template <class T>
@@ -111,26 +102,25 @@ inline bool
 BaseSettingsList<T>::SaveSettings(const std::map<unsigned int, T>& aSettings) {
     std::lock_guard<std::mutex> lock(mSettingsFileMutex);
 
-    QFile file(mFileName.c_str());
-    file.open(QIODevice::WriteOnly);
-
-    QXmlStreamWriter xml(&file);
-    xml.setAutoFormatting(true);
-
-    xml.writeStartDocument();
-    xml.writeStartElement(QString::fromStdString(mSettingsRoot));
-
+    SettingsTree root;
     for (auto node : aSettings) {
-        xml.writeStartElement(QString::fromStdString(mElementName));
-        xml.writeAttribute("id", QString::number(node.first));
-        Save(xml, node.second);
-        xml.writeEndElement();
+        SettingsTree element;
+        element.put("<xmlattr>.id", node.first);
+        Save(element, node.second);
+        root.add_child(mElementName, element);
+    }
+    SettingsTree tree;
+    tree.add_child(mSettingsRoot, root);
+
+    try {
+        boost::property_tree::write_xml(mFileName, tree, std::locale(),
+            boost::property_tree::xml_writer_make_settings<std::string>(' ', 4));
+    } catch (std::exception& e) {
+        LOGGER_LOG(PriorityEnum::Error, "Не удалось сохранить настройки в %s: %s", mFileName.c_str(), e.what());
+        return false;
     }
 
-    xml.writeEndElement();
-    xml.writeEndDocument();
-
-    return false;
+    return true;
 }
 
 template <class T>
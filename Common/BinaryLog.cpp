@@ -0,0 +1,66 @@
+// Copyright 2018
+
+#include "BinaryLog.h"
+
+namespace Fatracing {
+
+namespace {
+//! Пауза потока бэкенда при пустой очереди
+const std::chrono::milliseconds IdleSleep(2);
+}
+
+BinaryLogger::BinaryLogger() : mLogger(Logger::Instance()), mQueue(QueueCapacity) {
+	StartThread();
+}
+
+BinaryLogger::~BinaryLogger() {
+	StopThread();
+	// дописываем то, что осталось в очереди
+	Drain();
+}
+
+BinaryLogger& BinaryLogger::Instance() {
+	static BinaryLogger instance;
+	return instance;
+}
+
+uint64_t BinaryLogger::GetDroppedCount() const {
+	return mDroppedTotal;
+}
+
+void BinaryLogger::ThreadFunc() {
+	while (IsThreadActive()) {
+		if (Drain() == 0) {
+			std::this_thread::sleep_for(IdleSleep);
+		}
+	}
+}
+
+size_t BinaryLogger::Drain() {
+	size_t count = 0;
+	Record record;
+	while (mQueue.TryPop(record)) {
+		Process(record);
+		++count;
+	}
+
+	const uint64_t dropped = mDropped.exchange(0);
+	if (dropped > 0) {
+		mLogger.Write(PriorityEnum::Warning, std::chrono::system_clock::now(), "BinaryLog.cpp", __func__, __LINE__,
+		              Utils::Format("Очередь быстрого логирования переполнена, потеряно записей: %llu",
+		                            static_cast<unsigned long long>(dropped)));
+	}
+	return count;
+}
+
+void BinaryLogger::Process(const Record& aRecord) {
+	const BinaryLogSite& site = *aRecord.Site;
+	const std::string message = aRecord.Truncated
+		? std::string(site.Format) + " [аргументы не поместились в запись]"
+		: aRecord.Decode(site.Format, aRecord.Data);
+
+	const std::chrono::system_clock::time_point time{std::chrono::system_clock::duration(aRecord.Time)};
+	mLogger.Write(site.Priority, time, Utils::GetFileNameWithExtension(site.File), site.Function, site.Line, message);
+}
+
+} // namespace Fatracing
@@ -0,0 +1,260 @@
+// Copyright 2018
+
+#ifndef COMMON_BINARY_LOG_H_
+#define COMMON_BINARY_LOG_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+#include "BaseThread.h"
+#include "BoundedQueue.h"
+#include "Logger.h"
+
+namespace Fatracing
+{
+//! Место вызова быстрого логирования.
+//! Создаётся один раз на каждую строку с LOGGER_LOG_FAST как статическая константа,
+//! адрес служит идентификатором места вызова.
+struct BinaryLogSite
+{
+	//! Приоритет
+	PriorityEnum Priority;
+	//! Файл из которого был вызван логгер
+	const char* File;
+	//! Функция из которой был вызван логгер
+	const char* Function;
+	//! Строка из которой был вызван логгер
+	int Line;
+	//! Формат сообщения (printf)
+	const char* Format;
+};
+
+namespace BinaryLogDetail
+{
+//! Размер области под аргументы в одной записи
+const size_t MaxArgsSize = 96;
+//! Признак того, что аргументы не поместились в запись
+const size_t Overflow = MaxArgsSize + 1;
+
+//! Кодирование аргумента: арифметические типы, перечисления и указатели копируются как есть
+template <typename T>
+struct ArgCodec
+{
+	static_assert(std::is_arithmetic<T>::value || std::is_enum<T>::value || std::is_pointer<T>::value,
+	              "LOGGER_LOG_FAST supports only arithmetic, enum, pointer and C string arguments");
+
+	typedef T Value;
+
+	static size_t Write(uint8_t* aData, size_t aOffset, const T& aValue)
+	{
+		if (aOffset + sizeof(T) > MaxArgsSize)
+		{
+			return Overflow;
+		}
+		std::memcpy(aData + aOffset, &aValue, sizeof(T));
+		return aOffset + sizeof(T);
+	}
+
+	static size_t Read(const uint8_t* aData, size_t aOffset, Value& aValue)
+	{
+		std::memcpy(&aValue, aData + aOffset, sizeof(T));
+		return aOffset + sizeof(T);
+	}
+};
+
+//! Кодирование C-строки: содержимое копируется в запись (с обрезкой), а не указатель
+template <>
+struct ArgCodec<const char*>
+{
+	typedef const char* Value;
+
+	static size_t Write(uint8_t* aData, size_t aOffset, const char* aValue)
+	{
+		if (aOffset >= MaxArgsSize)
+		{
+			return Overflow;
+		}
+		const char* value = aValue ? aValue : "(null)";
+		size_t length = std::strlen(value);
+		if (length > MaxArgsSize - aOffset - 1)
+		{
+			length = MaxArgsSize - aOffset - 1;
+		}
+		std::memcpy(aData + aOffset, value, length);
+		aData[aOffset + length] = '\0';
+		return aOffset + length + 1;
+	}
+
+	static size_t Read(const uint8_t* aData, size_t aOffset, Value& aValue)
+	{
+		aValue = reinterpret_cast<const char*>(aData + aOffset);
+		return aOffset + std::strlen(aValue) + 1;
+	}
+};
+
+template <>
+struct ArgCodec<char*> : ArgCodec<const char*>
+{
+};
+
+inline size_t Encode(uint8_t* /*aData*/, size_t aOffset)
+{
+	return aOffset;
+}
+
+template <typename T, typename... Rest>
+size_t Encode(uint8_t* aData, size_t aOffset, const T& aValue, const Rest&... aRest)
+{
+	aOffset = ArgCodec<typename std::decay<T>::type>::Write(aData, aOffset, aValue);
+	if (aOffset == Overflow)
+	{
+		return Overflow;
+	}
+	return Encode(aData, aOffset, aRest...);
+}
+
+//! Раскодирование аргументов и форматирование сообщения (выполняется на потоке бэкенда)
+template <typename... Args>
+struct Decoder;
+
+template <>
+struct Decoder<>
+{
+	template <typename... Values>
+	static std::string Run(const char* aFormat, const uint8_t* /*aData*/, size_t /*aOffset*/, Values... aValues)
+	{
+		return Utils::Format(aFormat, aValues...);
+	}
+};
+
+template <typename T, typename... Rest>
+struct Decoder<T, Rest...>
+{
+	template <typename... Values>
+	static std::string Run(const char* aFormat, const uint8_t* aData, size_t aOffset, Values... aValues)
+	{
+		typename ArgCodec<T>::Value value;
+		aOffset = ArgCodec<T>::Read(aData, aOffset, value);
+		return Decoder<Rest...>::Run(aFormat, aData, aOffset, aValues..., value);
+	}
+};
+
+template <typename... Args>
+std::string Decode(const char* aFormat, const uint8_t* aData)
+{
+	return Decoder<Args...>::Run(aFormat, aData, 0);
+}
+} // namespace BinaryLogDetail
+
+//! Быстрый логгер для горячих путей (обработка импульсов, таймер гонки).
+//! На вызывающем потоке сохраняется только адрес места вызова, время и сырые байты аргументов
+//! в заранее выделенную очередь; форматирование, фильтрация повторов и запись в Logger
+//! выполняются на отдельном потоке. Если очередь заполнена, запись отбрасывается.
+//! Используйте LOGGER_LOG_FAST.
+class BinaryLogger : protected BaseThread
+{
+public:
+	typedef std::string (*DecodeFunction)(const char* aFormat, const uint8_t* aData);
+
+	//! Запись в очереди
+	struct Record
+	{
+		//! Место вызова
+		const BinaryLogSite* Site;
+		//! Функция раскодирования аргументов
+		DecodeFunction Decode;
+		//! Время (system_clock)
+		std::chrono::system_clock::rep Time;
+		//! Аргументы не поместились в запись
+		bool Truncated;
+		//! Сырые байты аргументов
+		uint8_t Data[BinaryLogDetail::MaxArgsSize];
+	};
+
+private:
+	//! Количество записей в очереди
+	static const size_t QueueCapacity = 8192;
+	Logger& mLogger;
+	BoundedQueue<Record> mQueue;
+	//! Количество отброшенных записей с момента последнего отчёта
+	std::atomic<uint64_t> mDropped{0};
+	//! Всего отброшено записей
+	std::atomic<uint64_t> mDroppedTotal{0};
+
+	BinaryLogger();
+	~BinaryLogger();
+
+public:
+	//! Получить экземпляр синглтона
+	static BinaryLogger& Instance();
+
+	//! Логгирование, используйте LOGGER_LOG_FAST
+	template <typename... Args>
+	void Log(const BinaryLogSite& aSite, const Args&... aArgs);
+
+	//! Общее количество отброшенных записей
+	uint64_t GetDroppedCount() const;
+
+protected:
+	void ThreadFunc() override;
+
+private:
+	//! Раскодировать запись и передать в Logger
+	void Process(const Record& aRecord);
+	//! Обработать всё, что есть в очереди, возвращает количество записей
+	size_t Drain();
+};
+
+template <typename... Args>
+void BinaryLogger::Log(const BinaryLogSite& aSite, const Args&... aArgs)
+{
+	if (!mLogger.IsEnabled(aSite.Priority))
+	{
+		return;
+	}
+
+	Record record;
+	record.Site = &aSite;
+	record.Decode = &BinaryLogDetail::Decode<typename std::decay<Args>::type...>;
+	record.Time = std::chrono::system_clock::now().time_since_epoch().count();
+	record.Truncated = BinaryLogDetail::Encode(record.Data, 0, aArgs...) == BinaryLogDetail::Overflow;
+
+	if (!mQueue.TryPush(record))
+	{
+		++mDropped;
+		++mDroppedTotal;
+	}
+}
+
+#ifdef _WIN32
+
+#define LOGGER_LOG_FAST(priority, format, ...) \
+    do { \
+        if (false) \
+            ::Fatracing::Utils::CheckFormat(format, __VA_ARGS__); \
+        if (static_cast<int>(priority) >= LOGGER_MIN_LEVEL && ::Fatracing::Logger::Instance().IsEnabled(priority)) { \
+            static const ::Fatracing::BinaryLogSite loggerLogSite = {priority, __FILE__, __func__, __LINE__, format}; \
+            ::Fatracing::BinaryLogger::Instance().Log(loggerLogSite, __VA_ARGS__); \
+        } \
+    } while (0)
+
+#elif __linux__
+
+#define LOGGER_LOG_FAST(priority, format, ...) \
+    do { \
+        if (false) \
+            ::Fatracing::Utils::CheckFormat(format, ##__VA_ARGS__); \
+        if (static_cast<int>(priority) >= LOGGER_MIN_LEVEL && ::Fatracing::Logger::Instance().IsEnabled(priority)) { \
+            static const ::Fatracing::BinaryLogSite loggerLogSite = {priority, __FILE__, __func__, __LINE__, format}; \
+            ::Fatracing::BinaryLogger::Instance().Log(loggerLogSite, ##__VA_ARGS__); \
+        } \
+    } while (0)
+
+#endif
+
+} // namespace Fatracing
+
+#endif // COMMON_BINARY_LOG_H_
@@ -0,0 +1,141 @@
+// Copyright 2018
+
+#ifndef COMMON_BOUNDED_QUEUE_H_
+#define COMMON_BOUNDED_QUEUE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+namespace Fatracing
+{
+//! Ограниченная неблокирующая очередь (много писателей / много читателей).
+//! Память под элементы выделяется один раз в конструкторе, при переполнении
+//! TryPush возвращает false вместо ожидания. Ёмкость округляется до степени двойки.
+template <typename T>
+class BoundedQueue
+{
+	struct Cell
+	{
+		std::atomic<size_t> Sequence;
+		T Value;
+	};
+
+	std::unique_ptr<Cell[]> mCells;
+	size_t mMask;
+
+	// позиции писателей и читателей разнесены по разным кэш-линиям
+	char mPad0[64];
+	std::atomic<size_t> mEnqueuePos{0};
+	char mPad1[64];
+	std::atomic<size_t> mDequeuePos{0};
+	char mPad2[64];
+
+public:
+	//! Конструктор
+	//! @param aCapacity минимальная ёмкость очереди
+	explicit BoundedQueue(size_t aCapacity);
+
+	BoundedQueue(const BoundedQueue&) = delete;
+	BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+	//! Положить элемент, false если очередь заполнена
+	bool TryPush(const T& aValue);
+	//! Забрать элемент, false если очередь пуста
+	bool TryPop(T& aValue);
+
+	//! Примерное количество элементов в очереди
+	size_t Size() const;
+	//! Ёмкость очереди
+	size_t Capacity() const { return mMask + 1; }
+};
+
+template <typename T>
+BoundedQueue<T>::BoundedQueue(size_t aCapacity)
+{
+	size_t capacity = 2;
+	while (capacity < aCapacity)
+	{
+		capacity <<= 1;
+	}
+	mCells.reset(new Cell[capacity]);
+	mMask = capacity - 1;
+	for (size_t i = 0; i < capacity; ++i)
+	{
+		mCells[i].Sequence.store(i, std::memory_order_relaxed);
+	}
+}
+
+template <typename T>
+bool BoundedQueue<T>::TryPush(const T& aValue)
+{
+	size_t pos = mEnqueuePos.load(std::memory_order_relaxed);
+	for (;;)
+	{
+		Cell& cell = mCells[pos & mMask];
+		const size_t sequence = cell.Sequence.load(std::memory_order_acquire);
+		const intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+		if (diff == 0)
+		{
+			if (mEnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+			{
+				cell.Value = aValue;
+				cell.Sequence.store(pos + 1, std::memory_order_release);
+				return true;
+			}
+		}
+		else if (diff < 0)
+		{
+			// очередь заполнена
+			return false;
+		}
+		else
+		{
+			pos = mEnqueuePos.load(std::memory_order_relaxed);
+		}
+	}
+}
+
+template <typename T>
+bool BoundedQueue<T>::TryPop(T& aValue)
+{
+	size_t pos = mDequeuePos.load(std::memory_order_relaxed);
+	for (;;)
+	{
+		Cell& cell = mCells[pos & mMask];
+		const size_t sequence = cell.Sequence.load(std::memory_order_acquire);
+		const intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1);
+		if (diff == 0)
+		{
+			if (mDequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+			{
+				// ячейка освобождается сразу: иначе значение (shared_ptr) живёт до перезаписи ячейки
+				aValue = std::move(cell.Value);
+				cell.Value = T();
+				cell.Sequence.store(pos + mMask + 1, std::memory_order_release);
+				return true;
+			}
+		}
+		else if (diff < 0)
+		{
+			// очередь пуста
+			return false;
+		}
+		else
+		{
+			pos = mDequeuePos.load(std::memory_order_relaxed);
+		}
+	}
+}
+
+template <typename T>
+size_t BoundedQueue<T>::Size() const
+{
+	const size_t enqueued = mEnqueuePos.load(std::memory_order_relaxed);
+	const size_t dequeued = mDequeuePos.load(std::memory_order_relaxed);
+	return enqueued > dequeued ? enqueued - dequeued : 0;
+}
+} // namespace Fatracing
+
+#endif // COMMON_BOUNDED_QUEUE_H_
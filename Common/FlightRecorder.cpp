@@ -0,0 +1,215 @@
+// Copyright 2018
+
+#include "FlightRecorder.h"
+
+#include <csignal>
+#include <cstring>
+#include <exception>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace Fatracing {
+
+namespace {
+//! Самописец, который сбрасывается при падении
+std::atomic<const FlightRecorder*> gCrashRecorder{nullptr};
+//! Путь к файлу дампа при падении (заполняется заранее, в обработчике строки не собираются)
+char gCrashFilePath[512];
+//! Предыдущий обработчик std::terminate
+std::terminate_handler gPreviousTerminate = nullptr;
+//! Дамп уже записан
+std::atomic<bool> gCrashDumped{false};
+
+const char* const PriorityNames[] = {"TRACE", "DEBUG", "INFO", "WARNING", "ERROR", "SUCCESS"};
+
+void Append(char* aBuffer, size_t& aPos, size_t aSize, const char* aString) {
+	while (*aString != '\0' && aPos < aSize) {
+		aBuffer[aPos++] = *aString++;
+	}
+}
+
+void AppendNumber(char* aBuffer, size_t& aPos, size_t aSize, uint64_t aValue, int aWidth = 0) {
+	char digits[24];
+	int count = 0;
+	do {
+		digits[count++] = static_cast<char>('0' + aValue % 10);
+		aValue /= 10;
+	} while (aValue != 0 && count < static_cast<int>(sizeof(digits)));
+	while (count < aWidth && count < static_cast<int>(sizeof(digits))) {
+		digits[count++] = '0';
+	}
+	while (count > 0 && aPos < aSize) {
+		aBuffer[aPos++] = digits[--count];
+	}
+}
+
+void CrashDump() {
+	bool expected = false;
+	if (!gCrashDumped.compare_exchange_strong(expected, true)) {
+		return;
+	}
+	const FlightRecorder* recorder = gCrashRecorder.load();
+	if (recorder) {
+		recorder->Dump(gCrashFilePath);
+	}
+}
+
+#ifdef __linux__
+void SignalHandler(int aSignal) {
+	CrashDump();
+	// возвращаем стандартный обработчик и повторяем сигнал, чтобы процесс завершился как обычно
+	signal(aSignal, SIG_DFL);
+	raise(aSignal);
+}
+#endif
+
+void TerminateHandler() {
+	CrashDump();
+	if (gPreviousTerminate) {
+		gPreviousTerminate();
+	}
+	std::abort();
+}
+} // namespace
+
+FlightRecorder::FlightRecorder(size_t aCapacity) :
+	mEntries(new Entry[aCapacity > 0 ? aCapacity : 1]),
+	mCapacity(aCapacity > 0 ? aCapacity : 1) {
+}
+
+void FlightRecorder::Record(int aPriority, std::chrono::system_clock::time_point aTime, const char* aFile,
+                            const char* aFunction, int aLine, const char* aMessage) {
+	const uint64_t number = mNext.fetch_add(1, std::memory_order_relaxed);
+	Entry& entry = mEntries[number % mCapacity];
+
+	entry.Sequence.store(2 * number + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	entry.TimeUs = std::chrono::duration_cast<std::chrono::microseconds>(aTime.time_since_epoch()).count();
+	entry.Priority = aPriority;
+	entry.Line = aLine;
+	// для файла оставляем только имя без пути
+	const char* fileName = aFile;
+	for (const char* c = aFile; c != nullptr && *c != '\0'; ++c) {
+		if (*c == '/' || *c == '\\') {
+			fileName = c + 1;
+		}
+	}
+	CopyString(entry.File, FileSize, fileName);
+	CopyString(entry.Function, FunctionSize, aFunction);
+	CopyString(entry.Message, MessageSize, aMessage);
+
+	entry.Sequence.store(2 * number + 2, std::memory_order_release);
+}
+
+void FlightRecorder::CopyString(char* aDest, size_t aSize, const char* aSource) {
+	if (aSource == nullptr) {
+		aDest[0] = '\0';
+		return;
+	}
+	size_t i = 0;
+	for (; i + 1 < aSize && aSource[i] != '\0'; ++i) {
+		aDest[i] = aSource[i];
+	}
+	aDest[i] = '\0';
+}
+
+bool FlightRecorder::Dump(const char* aFilePath) const {
+#ifdef __linux__
+	const int fd = open(aFilePath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		return false;
+	}
+	DumpToFd(fd);
+	fsync(fd);
+	close(fd);
+	return true;
+#else
+	(void)aFilePath;
+	return false;
+#endif
+}
+
+void FlightRecorder::DumpToFd(int aFd) const {
+#ifdef __linux__
+	const uint64_t next = mNext.load(std::memory_order_acquire);
+	const uint64_t first = next > mCapacity ? next - mCapacity : 0;
+
+	char line[MessageSize + FileSize + FunctionSize + 96];
+	for (uint64_t number = first; number < next; ++number) {
+		const Entry& slot = mEntries[number % mCapacity];
+		const uint64_t sequence = 2 * number + 2;
+		if (slot.Sequence.load(std::memory_order_acquire) != sequence) {
+			// запись ещё заполняется или уже перезаписана
+			continue;
+		}
+		// чтение seqlock: поля копируются, затем номер проверяется ещё раз -
+		// если писатель успел занять ячейку во время копирования, строка смешала бы две записи
+		Entry entry;
+		entry.TimeUs = slot.TimeUs;
+		entry.Priority = slot.Priority;
+		entry.Line = slot.Line;
+		std::memcpy(entry.File, slot.File, FileSize);
+		std::memcpy(entry.Function, slot.Function, FunctionSize);
+		std::memcpy(entry.Message, slot.Message, MessageSize);
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (slot.Sequence.load(std::memory_order_relaxed) != sequence) {
+			continue;
+		}
+		entry.File[FileSize - 1] = '\0';
+		entry.Function[FunctionSize - 1] = '\0';
+		entry.Message[MessageSize - 1] = '\0';
+
+		size_t pos = 0;
+		const size_t size = sizeof(line) - 1;
+		const uint64_t timeUs = entry.TimeUs > 0 ? static_cast<uint64_t>(entry.TimeUs) : 0;
+		Append(line, pos, size, "[");
+		AppendNumber(line, pos, size, timeUs / 1000000);
+		Append(line, pos, size, ".");
+		AppendNumber(line, pos, size, timeUs % 1000000, 6);
+		Append(line, pos, size, "] ");
+		const bool knownPriority = entry.Priority >= 0 &&
+			entry.Priority < static_cast<int>(sizeof(PriorityNames) / sizeof(PriorityNames[0]));
+		Append(line, pos, size, knownPriority ? PriorityNames[entry.Priority] : "?");
+		Append(line, pos, size, " ");
+		Append(line, pos, size, entry.File);
+		Append(line, pos, size, "(");
+		AppendNumber(line, pos, size, static_cast<uint64_t>(entry.Line > 0 ? entry.Line : 0));
+		Append(line, pos, size, ")::");
+		Append(line, pos, size, entry.Function);
+		Append(line, pos, size, "(): ");
+		Append(line, pos, size, entry.Message);
+		line[pos++] = '\n';
+
+		if (write(aFd, line, pos) < 0) {
+			return;
+		}
+	}
+#else
+	(void)aFd;
+#endif
+}
+
+void FlightRecorder::InstallCrashHandlers(const std::string& aFilePath) {
+	CopyString(gCrashFilePath, sizeof(gCrashFilePath), aFilePath.c_str());
+	gCrashRecorder = this;
+
+#ifdef __linux__
+	struct sigaction action;
+	std::memset(&action, 0, sizeof(action));
+	action.sa_handler = &SignalHandler;
+	sigemptyset(&action.sa_mask);
+	for (int signalNumber : {SIGSEGV, SIGABRT, SIGBUS, SIGFPE, SIGILL}) {
+		sigaction(signalNumber, &action, nullptr);
+	}
+#endif
+	std::terminate_handler previous = std::set_terminate(&TerminateHandler);
+	if (previous != &TerminateHandler) {
+		gPreviousTerminate = previous;
+	}
+}
+
+} // namespace Fatracing
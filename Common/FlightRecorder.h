@@ -0,0 +1,77 @@
+// Copyright 2018
+
+#ifndef COMMON_FLIGHT_RECORDER_H_
+#define COMMON_FLIGHT_RECORDER_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace Fatracing
+{
+//! Бортовой самописец: кольцо из последних N записей лога всех уровней в памяти.
+//! Память выделяется один раз, запись не выделяет память и не берёт блокировок.
+//! Содержимое сбрасывается в файл по запросу или при падении (SIGSEGV, SIGABRT, std::terminate).
+class FlightRecorder
+{
+public:
+	//! Размер текста сообщения в записи (длинные сообщения обрезаются)
+	static const size_t MessageSize = 176;
+	static const size_t FileSize = 32;
+	static const size_t FunctionSize = 32;
+
+	//! Запись кольца
+	struct Entry
+	{
+		//! 2 * номер + 1 пока запись заполняется, 2 * номер + 2 когда готова
+		std::atomic<uint64_t> Sequence{0};
+		//! Время, микросекунды от эпохи
+		int64_t TimeUs;
+		//! Приоритет (значение PriorityEnum)
+		int Priority;
+		//! Строка
+		int Line;
+		char File[FileSize];
+		char Function[FunctionSize];
+		char Message[MessageSize];
+	};
+
+private:
+	//! Кольцо записей
+	std::unique_ptr<Entry[]> mEntries;
+	//! Размер кольца
+	size_t mCapacity;
+	//! Номер следующей записи
+	std::atomic<uint64_t> mNext{0};
+
+public:
+	//! Конструктор
+	//! @param aCapacity количество хранимых записей
+	explicit FlightRecorder(size_t aCapacity);
+
+	FlightRecorder(const FlightRecorder&) = delete;
+	FlightRecorder& operator=(const FlightRecorder&) = delete;
+
+	//! Записать сообщение в кольцо
+	void Record(int aPriority, std::chrono::system_clock::time_point aTime, const char* aFile,
+	            const char* aFunction, int aLine, const char* aMessage);
+
+	//! Сбросить содержимое кольца в файл (от старых записей к новым)
+	bool Dump(const char* aFilePath) const;
+
+	//! Установить обработчики SIGSEGV/SIGABRT/SIGBUS/SIGFPE/SIGILL и std::terminate,
+	//! которые сбрасывают кольцо в файл перед завершением процесса
+	//! @param aFilePath путь к файлу дампа
+	void InstallCrashHandlers(const std::string& aFilePath);
+
+private:
+	//! Записать кольцо в открытый дескриптор, только async-signal-safe вызовы
+	void DumpToFd(int aFd) const;
+
+	static void CopyString(char* aDest, size_t aSize, const char* aSource);
+};
+} // namespace Fatracing
+
+#endif // COMMON_FLIGHT_RECORDER_H_
@@ -0,0 +1,121 @@
+// Copyright 2018
+
+#ifndef COMMON_LATENCY_HISTOGRAM_H_
+#define COMMON_LATENCY_HISTOGRAM_H_
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+namespace Fatracing
+{
+//! Гистограмма задержек с логарифмическими корзинами (16 корзин на каждую степень двойки,
+//! погрешность перцентилей не больше 1/16). Фиксированный размер, запись O(1) без выделения памяти.
+//! Не потокобезопасна: пишется и читается одним потоком.
+class LatencyHistogram
+{
+	static const int SubBucketBits = 4;
+	static const uint64_t SubBucketCount = 1u << SubBucketBits;
+	//! Значения до 2^40 мкс, всё что больше попадает в последнюю корзину
+	static const size_t BucketCount = (40 - SubBucketBits + 1) * SubBucketCount;
+
+	std::array<uint64_t, BucketCount> mBuckets;
+	uint64_t mCount = 0;
+	uint64_t mMaxUs = 0;
+	uint64_t mSumUs = 0;
+
+public:
+	LatencyHistogram() { Reset(); }
+
+	//! Очистить
+	void Reset()
+	{
+		mBuckets.fill(0);
+		mCount = 0;
+		mMaxUs = 0;
+		mSumUs = 0;
+	}
+
+	//! Добавить значение
+	void Record(std::chrono::steady_clock::duration aLatency)
+	{
+		const int64_t us = std::chrono::duration_cast<std::chrono::microseconds>(aLatency).count();
+		RecordUs(us > 0 ? static_cast<uint64_t>(us) : 0);
+	}
+
+	//! Добавить значение в микросекундах
+	void RecordUs(uint64_t aValueUs)
+	{
+		++mBuckets[BucketIndex(aValueUs)];
+		++mCount;
+		mSumUs += aValueUs;
+		if (aValueUs > mMaxUs)
+		{
+			mMaxUs = aValueUs;
+		}
+	}
+
+	//! Количество значений
+	uint64_t Count() const { return mCount; }
+	//! Максимум, мкс
+	uint64_t MaxUs() const { return mMaxUs; }
+	//! Среднее, мкс
+	double MeanUs() const { return mCount > 0 ? static_cast<double>(mSumUs) / mCount : 0.0; }
+
+	//! Перцентиль (0..100), мкс: верхняя граница корзины, в которую он попал
+	uint64_t PercentileUs(double aPercentile) const
+	{
+		if (mCount == 0)
+		{
+			return 0;
+		}
+		uint64_t rank = static_cast<uint64_t>(aPercentile / 100.0 * mCount + 0.5);
+		if (rank < 1)
+		{
+			rank = 1;
+		}
+		uint64_t seen = 0;
+		for (size_t i = 0; i < BucketCount; ++i)
+		{
+			seen += mBuckets[i];
+			if (seen >= rank)
+			{
+				const uint64_t upper = BucketUpperBound(i);
+				return upper < mMaxUs ? upper : mMaxUs;
+			}
+		}
+		return mMaxUs;
+	}
+
+private:
+	static size_t BucketIndex(uint64_t aValue)
+	{
+		if (aValue < SubBucketCount)
+		{
+			return static_cast<size_t>(aValue);
+		}
+		int msb = 63;
+		while ((aValue >> msb) == 0)
+		{
+			--msb;
+		}
+		const int shift = msb - SubBucketBits;
+		const size_t index = static_cast<size_t>(shift + 1) * SubBucketCount +
+			static_cast<size_t>((aValue >> shift) - SubBucketCount);
+		return index < BucketCount ? index : BucketCount - 1;
+	}
+
+	static uint64_t BucketUpperBound(size_t aIndex)
+	{
+		if (aIndex < SubBucketCount)
+		{
+			return aIndex;
+		}
+		const int shift = static_cast<int>(aIndex / SubBucketCount) - 1;
+		const uint64_t subBucket = aIndex % SubBucketCount + SubBucketCount;
+		return ((subBucket + 1) << shift) - 1;
+	}
+};
+} // namespace Fatracing
+
+#endif // COMMON_LATENCY_HISTOGRAM_H_
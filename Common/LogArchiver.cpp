@@ -0,0 +1,146 @@
+// Copyright 2018
+
+#include "LogArchiver.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/filesystem/path.hpp>
+
+#include <boost/iostreams/copy.hpp>
+#include <boost/iostreams/filter/gzip.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+
+namespace Fatracing {
+
+namespace {
+//! Имя сегмента лога: ГГГГ_ДД_ММ__чч_мм_сс[_NNN]<aExtension>[.gz] (Logger::MakeFilePath)
+bool IsSegmentName(const std::string& aName, const std::string& aExtension) {
+	static const char Pattern[] = "dddd_dd_dd__dd_dd_dd";
+	const size_t stampSize = sizeof(Pattern) - 1;
+	if (aName.size() < stampSize) {
+		return false;
+	}
+	for (size_t i = 0; i < stampSize; ++i) {
+		const bool digit = aName[i] >= '0' && aName[i] <= '9';
+		if (Pattern[i] == 'd' ? !digit : aName[i] != Pattern[i]) {
+			return false;
+		}
+	}
+	size_t pos = stampSize;
+	if (pos < aName.size() && aName[pos] == '_') {
+		// номер сегмента
+		const size_t digitsStart = ++pos;
+		while (pos < aName.size() && aName[pos] >= '0' && aName[pos] <= '9') {
+			++pos;
+		}
+		if (pos == digitsStart) {
+			return false;
+		}
+	}
+	const std::string rest = aName.substr(pos);
+	return rest == aExtension || rest == aExtension + ".gz";
+}
+} // namespace
+
+const int LogArchiver::WaitQueueSeconds;
+
+LogArchiver::LogArchiver() {
+	StartThread();
+}
+
+LogArchiver::~LogArchiver() {
+	// остановка потока отбрасывает очередь: сначала дожимаем закрытые сегменты
+	WaitQueue();
+	StopThread();
+}
+
+void LogArchiver::WaitQueue() {
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(WaitQueueSeconds);
+	while (BaseThread::IsThreadActive() && GetQueueSize() > 0 && std::chrono::steady_clock::now() < deadline) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+}
+
+void LogArchiver::SetParameters(bool aCompress, size_t aMaxSegments) {
+	mCompress = aCompress;
+	mMaxSegments = aMaxSegments;
+}
+
+void LogArchiver::AddSegment(const std::string& aFilePath) {
+	AddItem(std::make_shared<std::string>(aFilePath));
+}
+
+void LogArchiver::AddExistingSegments(const std::string& aCurrentFilePath, const std::string& aExtension) {
+	namespace fs = boost::filesystem;
+	const fs::path current = fs::absolute(aCurrentFilePath);
+	std::vector<std::pair<std::time_t, std::string>> segments;
+	boost::system::error_code error;
+	for (fs::directory_iterator it(current.parent_path(), error), end; !error && it != end; it.increment(error)) {
+		// только сегменты самого логгера: чужие *.log в каталоге (и дампы crash_*) не трогаются
+		if (it->path() == current || !IsSegmentName(it->path().filename().string(), aExtension)) {
+			continue;
+		}
+		boost::system::error_code timeError;
+		const std::time_t time = fs::last_write_time(it->path(), timeError);
+		segments.emplace_back(timeError ? 0 : time, it->path().string());
+	}
+	std::sort(segments.begin(), segments.end());
+	for (const auto& segment : segments) {
+		AddSegment(segment.second);
+	}
+}
+
+void LogArchiver::HandleWorkItem(std::shared_ptr<std::string> aFilePath) {
+	// сегмент прошлого запуска может быть уже сжат
+	const std::string& filePath = *aFilePath;
+	const bool compressed = filePath.size() > 3 && filePath.compare(filePath.size() - 3, 3, ".gz") == 0;
+	const std::string segment = mCompress && !compressed ? Compress(filePath) : filePath;
+	mSegments.push_back(segment);
+
+	// удаляем самые старые сегменты сверх лимита
+	const size_t maxSegments = mMaxSegments;
+	while (maxSegments > 0 && mSegments.size() > maxSegments) {
+		std::remove(mSegments.front().c_str());
+		mSegments.pop_front();
+	}
+}
+
+std::string LogArchiver::Compress(const std::string& aFilePath) {
+	const std::string compressedPath = aFilePath + ".gz";
+	const std::string tempPath = compressedPath + ".tmp";
+	try {
+		std::ifstream in(aFilePath, std::ios::in | std::ios::binary);
+		if (!in) {
+			return aFilePath;
+		}
+		std::ofstream out(tempPath, std::ios::out | std::ios::binary);
+		if (!out) {
+			return aFilePath;
+		}
+		boost::iostreams::filtering_ostream gzip;
+		gzip.push(boost::iostreams::gzip_compressor());
+		gzip.push(out);
+		boost::iostreams::copy(in, gzip);
+	} catch (const std::exception&) {
+		std::remove(tempPath.c_str());
+		return aFilePath;
+	}
+
+	// сегмент считается сжатым только после полной записи архива
+	if (std::rename(tempPath.c_str(), compressedPath.c_str()) != 0) {
+		std::remove(tempPath.c_str());
+		return aFilePath;
+	}
+	std::remove(aFilePath.c_str());
+	return compressedPath;
+}
+
+} // namespace Fatracing
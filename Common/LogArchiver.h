@@ -0,0 +1,53 @@
+// Copyright 2018
+
+#ifndef COMMON_LOG_ARCHIVER_H_
+#define COMMON_LOG_ARCHIVER_H_
+
+#include <deque>
+#include <string>
+
+#include "AsyncQueue.h"
+
+namespace Fatracing
+{
+//! Обработка закрытых сегментов лога на отдельном потоке:
+//! сжатие в gzip и удаление самых старых сегментов сверх лимита
+class LogArchiver : protected AsyncQueue<std::string>
+{
+	//! Сжимать ли сегменты
+	std::atomic<bool> mCompress{true};
+	//! Сколько закрытых сегментов хранить (0 - без ограничения)
+	std::atomic<size_t> mMaxSegments{0};
+	//! Закрытые сегменты (и оставшиеся от прошлых запусков), от старых к новым
+	std::deque<std::string> mSegments;
+	//! Сколько при остановке ждать обработки оставшейся очереди, с
+	static const int WaitQueueSeconds = 30;
+
+public:
+	LogArchiver();
+	~LogArchiver();
+
+	//! Установить параметры
+	//! @param aCompress сжимать ли сегменты
+	//! @param aMaxSegments сколько закрытых сегментов хранить (0 - без ограничения)
+	void SetParameters(bool aCompress, size_t aMaxSegments);
+	//! Передать закрытый сегмент на обработку
+	void AddSegment(const std::string& aFilePath);
+	//! Передать на обработку сегменты прошлых запусков из каталога лога (только имена,
+	//! которые даёт сам логгер: ГГГГ_ДД_ММ__чч_мм_сс[_NNN].log[.gz]),
+	//! от старых к новым, чтобы лимит сегментов действовал и между перезапусками
+	//! @param aCurrentFilePath открытый сейчас сегмент, не трогается
+	void AddExistingSegments(const std::string& aCurrentFilePath, const std::string& aExtension);
+
+protected:
+	void HandleWorkItem(std::shared_ptr<std::string> aFilePath) override;
+
+private:
+	//! Дождаться обработки очереди (при остановке)
+	void WaitQueue();
+	//! Сжать файл, возвращает путь к результату (или исходный путь при ошибке)
+	static std::string Compress(const std::string& aFilePath);
+};
+} // namespace Fatracing
+
+#endif // COMMON_LOG_ARCHIVER_H_
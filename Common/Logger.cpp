@@ -1,14 +1,15 @@
 ﻿// Copyright 2018
 
 #include "Logger.h"
+#include "LoggerSubscriber.h"
+#include "LogArchiver.h"
 
 namespace Fatracing {
-Logger::Logger() {
+Logger::Logger() : mArchiver(new LogArchiver()) {
+	mArchiver->SetParameters(mRotationSettings.Compress, mRotationSettings.MaxFiles);
 	if (mWriteToFileEnabled) {
 		OpenFile();
 	}
-
-	mLogLevel = PriorityEnum::Trace;
 }
 
 Logger& Logger::Instance() {
@@ -17,27 +18,66 @@ Logger& Logger::Instance() {
 }
 
 void Logger::Dump() {
+	std::lock_guard<std::mutex> lock(mMutex);
 	if (mFileStream.is_open()) {
 		mFileStream.flush();
 	}
 }
 
-void Logger::AddCallback(const std::string& aCallbackName, LoggerCallback aCallback) {
+void Logger::AddCallback(const std::string& aCallbackName, LoggerCallback aCallback, size_t aMaxQueueSize,
+                         LogDropPolicy aDropPolicy) {
 	if (aCallback == nullptr) {
 		return;
 	}
-	std::lock_guard<std::mutex> lock(mMutex);
-	mLoggerCallbacks[aCallbackName] = aCallback;
+	std::shared_ptr<LoggerSubscriber> subscriber = std::make_shared<LoggerSubscriber>(aCallback, aMaxQueueSize, aDropPolicy);
+	subscriber->Start();
+
+	std::shared_ptr<LoggerSubscriber> previous;
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		previous = mLoggerCallbacks[aCallbackName];
+		mLoggerCallbacks[aCallbackName] = subscriber;
+	}
+	// поток прежнего подписчика останавливается уже без блокировки логгера
 }
 
 void Logger::RemoveCallback(const std::string& aCallbackName) {
-    std::lock_guard<std::mutex> lock(mMutex);
-    mLoggerCallbacks.erase(aCallbackName);    
+	std::shared_ptr<LoggerSubscriber> subscriber;
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		auto itr = mLoggerCallbacks.find(aCallbackName);
+		if (itr == mLoggerCallbacks.end()) {
+			return;
+		}
+		subscriber = itr->second;
+		mLoggerCallbacks.erase(itr);
+	}
 }
 
 void Logger::ClearCallbacks() {
+	std::map<std::string, std::shared_ptr<LoggerSubscriber>> subscribers;
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		subscribers.swap(mLoggerCallbacks);
+	}
+}
+
+size_t Logger::GetCallbackQueueSize() {
 	std::lock_guard<std::mutex> lock(mMutex);
-	mLoggerCallbacks.clear();
+	size_t size = 0;
+	for (auto& x : mLoggerCallbacks) {
+		size += x.second->GetQueueSize();
+	}
+	return size;
+}
+
+uint64_t Logger::GetCallbackDroppedCount() {
+	std::lock_guard<std::mutex> lock(mMutex);
+	uint64_t dropped = 0;
+	for (auto& x : mLoggerCallbacks) {
+		dropped += x.second->GetDroppedCount();
+	}
+	return dropped;
 }
 
 void Logger::SetWriteToFileEnabled(bool aWriteToFileEnabled) {
@@ -49,8 +89,40 @@ void Logger::SetWriteToConsoleEnabled(bool aWriteToConsoleEnabled) {
 }
 
 void Logger::SetLogLevel(PriorityEnum aPriority) {
-	std::lock_guard<std::mutex> lock(mMutex);
 	mLogLevel = aPriority;
+	UpdateEnabledLevel();
+}
+
+void Logger::SetFlightRecorderLevel(PriorityEnum aPriority) {
+	mFlightRecorderLevel = aPriority;
+	UpdateEnabledLevel();
+}
+
+void Logger::UpdateEnabledLevel() {
+	const PriorityEnum logLevel = mLogLevel;
+	const PriorityEnum recorderLevel = mFlightRecorderLevel;
+	mEnabledLevel = logLevel < recorderLevel ? logLevel : recorderLevel;
+}
+
+bool Logger::DumpFlightRecorder(const std::string& aFilePath) {
+	return mFlightRecorder.Dump(aFilePath.c_str());
+}
+
+void Logger::InstallCrashHandlers(const std::string& aFilePath) {
+	const std::string filePath = aFilePath.empty()
+		? "crash_" + Utils::FormatFileNameYearMonthDayHourSecond(std::chrono::system_clock::now()) + LogFileExtension
+		: aFilePath;
+	mFlightRecorder.InstallCrashHandlers(filePath);
+}
+
+void Logger::SetRotationSettings(const LogRotationSettings& aSettings) {
+	std::lock_guard<std::mutex> lock(mMutex);
+	mRotationSettings = aSettings;
+	mArchiver->SetParameters(aSettings.Compress, aSettings.MaxFiles);
+}
+
+PriorityEnum Logger::GetLogLevel() const {
+	return mLogLevel;
 }
 
 std::string Logger::PriorityToString(PriorityEnum aPriority) {
@@ -58,26 +130,69 @@ std::string Logger::PriorityToString(PriorityEnum aPriority) {
 }
 
 Logger::~Logger() {
+	ClearCallbacks();
 	if (mFileStream.is_open()) {
 		mFileStream.flush();
 		mFileStream.close();
 	}
+	// дожидаемся сжатия уже закрытых сегментов
+	mArchiver.reset();
+}
+
+void Logger::Write(PriorityEnum aPriority, std::chrono::system_clock::time_point aTime, const std::string& aFile,
+                   const std::string& aFunction, int aLine, const std::string& aMessage) {
+	if (aPriority >= mFlightRecorderLevel) {
+		mFlightRecorder.Record(static_cast<int>(aPriority), aTime, aFile.c_str(), aFunction.c_str(), aLine,
+		                       aMessage.c_str());
+	}
+	if (aPriority < mLogLevel) {
+		return;
+	}
+	WriteEntry(aPriority, aTime, aFile, aFunction, aLine, aMessage);
+}
+
+void Logger::WriteEntry(PriorityEnum aPriority, std::chrono::system_clock::time_point aTime, const std::string& aFile,
+                        const std::string& aFunction, int aLine, const std::string& aMessage) {
+	// лочимся
+	std::lock_guard<std::mutex> lock(mMutex);
+	// собираем запись лога
+	std::shared_ptr<LogEntry> logEntry = std::make_shared<LogEntry>(aTime, aPriority, aMessage, aFile, aFunction, aLine);
+	// фильтруем идущие друг за другом одинаковые сообщения
+	bool repeatedLogEntry = false, replaceLogEntry = true;
+	if (logEntry->Message.compare(mLastLogEntry.Message) == 0) {
+		++mLastLogEntry.Counter;
+		mLastLogEntry.Time = logEntry->Time;
+		replaceLogEntry = false;
+		repeatedLogEntry = true;
+	} else if (mLastLogEntry.Counter > 0) {
+		// пишем то что повторялось один разик с указанием кол-ва повторов
+		ProcessLog(std::make_shared<LogEntry>(mLastLogEntry));
+		mLastLogEntry.Counter = 0;
+	}
+	if (!repeatedLogEntry) {
+		// пишем то что ещё не повторялось
+		ProcessLog(logEntry);
+	}
+	if (replaceLogEntry) {
+		mLastLogEntry = *logEntry;
+	}
 }
 
 void Logger::ProcessLog(std::shared_ptr<LogEntry> logEntry) {
 	// пишем лог в файл
 	if (mWriteToFileEnabled) {
-        if (mFileStream.is_open()) {
-#ifdef _WIN32
-            mFileStream << logEntry->Print() << std::endl;
-#elif __linux__
-            mFileStream << logEntry->Print() << std::endl;
-#endif
+		if (mFileStream.is_open()) {
+			if (IsRotationRequired()) {
+				RotateFile();
+			}
+			const std::string line = logEntry->Print();
+			mFileStream << line << std::endl;
+			mFileSize += line.size() + 1;
 		}
 	}
-	// выводим лог в GUI и другие компоненты
+	// передаём лог в GUI и другие компоненты, коллбеки вызываются на потоках подписчиков
 	for (auto& x : mLoggerCallbacks) {
-		x.second(logEntry);
+		x.second->Push(logEntry);
 	}
 	// выводим в консоль
 	if (mWriteToConsoleEnabled) {
@@ -89,8 +204,49 @@ bool Logger::OpenFile() {
 	if (mFileStream.is_open()) {
 		return false;
 	}
-	LogFilePath = Utils::FormatFileNameYearMonthDayHourSecond(std::chrono::system_clock::now()) + LogFileExtension;
+	LogFilePath = MakeFilePath();
 	mFileStream.open(LogFilePath, std::ofstream::out);
+	mFileSize = 0;
+	mFileOpenTime = std::chrono::steady_clock::now();
+	// сегменты прошлых запусков учитываются в лимите MaxFiles наравне с новыми
+	mArchiver->AddExistingSegments(LogFilePath, LogFileExtension);
 	return true;
 }
+
+bool Logger::IsRotationRequired() const {
+	if (mRotationSettings.MaxFileSize > 0 && mFileSize >= mRotationSettings.MaxFileSize) {
+		return true;
+	}
+	return mRotationSettings.MaxFileAge.count() > 0 &&
+		std::chrono::steady_clock::now() - mFileOpenTime >= mRotationSettings.MaxFileAge;
+}
+
+void Logger::RotateFile() {
+	++mSegmentIndex;
+	const std::string filePath = MakeFilePath();
+	std::ofstream fileStream(filePath, std::ofstream::out);
+	if (!fileStream.is_open()) {
+		// продолжаем писать в старый сегмент, попробуем в следующий раз
+		--mSegmentIndex;
+		mFileOpenTime = std::chrono::steady_clock::now();
+		return;
+	}
+
+	// переключаемся на новый файл, старый закрываем и отдаём на сжатие
+	std::swap(mFileStream, fileStream);
+	fileStream.close();
+	mArchiver->AddSegment(LogFilePath);
+
+	LogFilePath = filePath;
+	mFileSize = 0;
+	mFileOpenTime = std::chrono::steady_clock::now();
+}
+
+std::string Logger::MakeFilePath() const {
+	std::string filePath = Utils::FormatFileNameYearMonthDayHourSecond(std::chrono::system_clock::now());
+	if (mSegmentIndex > 0) {
+		filePath += Utils::Format("_%03u", mSegmentIndex);
+	}
+	return filePath + LogFileExtension;
+}
 } // namespace Fatracing
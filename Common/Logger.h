@@ -9,9 +9,24 @@
 #include <ctime>
 #include <mutex>
 #include "Utils.h"
+#include "FlightRecorder.h"
 #include <atomic>
 #include <iostream>
 
+//! Минимальный уровень логирования, задаваемый при компиляции (значение PriorityEnum).
+//! Вызовы LOGGER_LOG с меньшим приоритетом удаляются компилятором целиком, а макросы
+//! LOGGER_TRACE/LOGGER_DEBUG/... раскрываются в пустой оператор. Глобальное значение
+//! приходит из сборки (-DLOGGER_DEFAULT_MIN_LEVEL=N, кэш-переменная LOGGER_MIN_LEVEL
+//! в CMakeLists.txt); отдельная единица трансляции может переопределить его через
+//! #define LOGGER_MIN_LEVEL до первого включения Logger.h.
+#ifndef LOGGER_MIN_LEVEL
+#ifdef LOGGER_DEFAULT_MIN_LEVEL
+#define LOGGER_MIN_LEVEL LOGGER_DEFAULT_MIN_LEVEL
+#else
+#define LOGGER_MIN_LEVEL 0
+#endif
+#endif
+
 namespace Fatracing
 {
 //! Приоритет записи лога
@@ -25,6 +40,31 @@ enum class PriorityEnum : int
 	Success = 5
 };
 
+//! Что делать с записью, если очередь подписчика логгера заполнена
+enum class LogDropPolicy : int
+{
+	//! Выбросить самую старую запись из очереди
+	DropOldest = 0,
+	//! Не добавлять новую запись
+	DropNewest = 1
+};
+
+class LoggerSubscriber;
+class LogArchiver;
+
+//! Параметры ротации файла лога
+struct LogRotationSettings
+{
+	//! Максимальный размер сегмента, байт (0 - без ограничения)
+	uint64_t MaxFileSize = 64ull << 20;
+	//! Максимальное время записи в один сегмент (0 - без ограничения)
+	std::chrono::seconds MaxFileAge = std::chrono::hours(6);
+	//! Сколько закрытых сегментов хранить (0 - без ограничения)
+	size_t MaxFiles = 50;
+	//! Сжимать закрытые сегменты (gzip, на отдельном потоке)
+	bool Compress = true;
+};
+
 //! Логгер
 class Logger
 {
@@ -74,9 +114,24 @@ public:
 
 		std::string Print() const
 		{
-			return Utils::Format(Time) + PriorityToString(Priority) + " " + File + "(" + std::to_string(Line) + ")::" + Function
-				+
-				"(): " + Message + (Counter > 0 ? " [" + std::to_string(Counter) + "]" : "");
+			char header[64];
+			size_t size = Utils::FormatTimestampTo(header, sizeof(header), Time);
+			size += Utils::FormatTo(header + size, sizeof(header) - size, "%s ",
+			                        PriorityToString(Priority).c_str());
+
+			std::string result;
+			result.reserve(size + File.size() + Function.size() + Message.size() + 32);
+			result.append(header, size);
+			result += File;
+			result += "(" + std::to_string(Line) + ")::";
+			result += Function;
+			result += "(): ";
+			result += Message;
+			if (Counter > 0)
+			{
+				result += " [" + std::to_string(Counter) + "]";
+			}
+			return result;
 		}
 
 		//! Время
@@ -99,6 +154,9 @@ public:
 	//! Колбек для передачи лога в GUI
 	typedef std::function<void(std::shared_ptr<LogEntry>)> LoggerCallback;
 
+	//! Размер очереди подписчика по умолчанию
+	static const size_t DefaultCallbackQueueSize = 4096;
+
 private:
 	//! Конструктор
 	Logger();
@@ -111,13 +169,23 @@ private:
 	const char* LogFileExtension = ".log";
 	//! Куда пишем лог
 	std::ofstream mFileStream;
+	//! Сколько байт записано в текущий сегмент
+	uint64_t mFileSize = 0;
+	//! Когда открыт текущий сегмент
+	std::chrono::steady_clock::time_point mFileOpenTime;
+	//! Номер текущего сегмента
+	unsigned int mSegmentIndex = 0;
+	//! Параметры ротации
+	LogRotationSettings mRotationSettings;
+	//! Сжатие и удаление закрытых сегментов
+	std::unique_ptr<LogArchiver> mArchiver;
 
 	//! Строки для приоритетов лога
 	const std::vector<std::string> PriorityString = {"TRACE", "DEBUG", "INFO", "WARNING", "ERROR", "SUCCESS"};
 	//! Мютекс файла
 	std::mutex mMutex;
-	//! Колбек для передачи логов в GUI
-	std::map<std::string, LoggerCallback> mLoggerCallbacks;
+	//! Подписчики (коллбеки для передачи логов в GUI и другие модули), каждый со своим потоком
+	std::map<std::string, std::shared_ptr<LoggerSubscriber>> mLoggerCallbacks;
 
 	//! Пишет ли данный класс лог в файл
 	std::atomic<bool> mWriteToFileEnabled{true};
@@ -126,7 +194,16 @@ private:
 	//! Последняя запись
 	LogEntry mLastLogEntry;
 	//! Уровень логирования
-	PriorityEnum mLogLevel;
+	std::atomic<PriorityEnum> mLogLevel{PriorityEnum::Trace};
+	//! Уровень записи в бортовой самописец
+	std::atomic<PriorityEnum> mFlightRecorderLevel{PriorityEnum::Trace};
+	//! Минимальный из уровней логирования и самописца, ниже него сообщения не собираются
+	std::atomic<PriorityEnum> mEnabledLevel{PriorityEnum::Trace};
+
+	//! Количество записей в бортовом самописце
+	static const size_t FlightRecorderCapacity = 4096;
+	//! Бортовой самописец: последние записи всех уровней в памяти
+	FlightRecorder mFlightRecorder{FlightRecorderCapacity};
 
 public:
 	//! Получить экземпляр синглтона
@@ -135,13 +212,22 @@ public:
 	//! Дамп
 	void Dump();
 
-	//! Добавить коллбек для событий логирования (для визуализации в GUI и передачи в другие модули)
+	//! Добавить коллбек для событий логирования (для визуализации в GUI и передачи в другие модули).
+	//! Коллбек вызывается асинхронно на отдельном потоке подписчика.
 	//! @param aCallback коллбек в который будут приходить лог сообщения
-	void AddCallback(const std::string& aCallbackName, LoggerCallback aCallback);
+	//! @param aMaxQueueSize максимальный размер очереди подписчика (0 - без ограничения)
+	//! @param aDropPolicy что делать при переполнении очереди
+	void AddCallback(const std::string& aCallbackName, LoggerCallback aCallback,
+	                 size_t aMaxQueueSize = DefaultCallbackQueueSize,
+	                 LogDropPolicy aDropPolicy = LogDropPolicy::DropOldest);
     //! Удалить коллбек
     void RemoveCallback(const std::string& aCallbackName);
 	//! Обнулить коллбеки событий логирования
 	void ClearCallbacks();
+	//! Суммарное количество записей в очередях подписчиков
+	size_t GetCallbackQueueSize();
+	//! Суммарное количество записей, отброшенных подписчиками
+	uint64_t GetCallbackDroppedCount();
 
 	//! Установить запись в файл
 	void SetWriteToFileEnabled(bool aWriteToFileEnabled);
@@ -149,7 +235,22 @@ public:
 	void SetWriteToConsoleEnabled(bool aWriteToConsoleEnabled);
 	//! Установить уровень логгирования
 	void SetLogLevel(PriorityEnum aPriority);
-
+	//! Установить параметры ротации файла лога
+	void SetRotationSettings(const LogRotationSettings& aSettings);
+	//! Установить уровень записи в бортовой самописец
+	void SetFlightRecorderLevel(PriorityEnum aPriority);
+	//! Сбросить бортовой самописец в файл
+	bool DumpFlightRecorder(const std::string& aFilePath);
+	//! Сбрасывать бортовой самописец в файл при падении (SIGSEGV, SIGABRT, std::terminate)
+	//! @param aFilePath путь к файлу дампа, по умолчанию crash_<время запуска>.log
+	void InstallCrashHandlers(const std::string& aFilePath = "");
+
+	//! Получить уровень логгирования
+	PriorityEnum GetLogLevel() const;
+	//! Проверка уровня без блокировок, выполняется до сборки аргументов
+	bool IsEnabled(PriorityEnum aPriority) const {
+		return aPriority >= mEnabledLevel.load(std::memory_order_relaxed);
+	}
 
 	//! Преобразовать приоритет в строку
 	static std::string PriorityToString(PriorityEnum aPriority);
@@ -157,8 +258,16 @@ public:
 
 	//! Логгирование, используйте LOGGER_LOG
 	template <typename... Args>
-	void Log(PriorityEnum aPriority, std::string aFile, std::string aFunction, int aLine, std::string format,
+	void Log(PriorityEnum aPriority, const char* aFile, const char* aFunction, int aLine, const char* format,
 	         Args&&... vs);
+	template <typename... Args>
+	void Log(PriorityEnum aPriority, const char* aFile, const char* aFunction, int aLine, const std::string& format,
+	         Args&&... vs);
+
+	//! Записать уже собранное сообщение: самописец, затем (если проходит по уровню)
+	//! фильтрация повторов, файл, коллбеки, консоль. Используется бэкендом BinaryLogger
+	void Write(PriorityEnum aPriority, std::chrono::system_clock::time_point aTime, const std::string& aFile,
+	           const std::string& aFunction, int aLine, const std::string& aMessage);
 
 #ifdef __linux__
     // template <typename... Args>
@@ -170,78 +279,121 @@ public:
 #endif
 
 private:
+	//! Записать сообщение, прошедшее по уровню логирования
+	void WriteEntry(PriorityEnum aPriority, std::chrono::system_clock::time_point aTime, const std::string& aFile,
+	                const std::string& aFunction, int aLine, const std::string& aMessage);
+	//! Пересчитать mEnabledLevel
+	void UpdateEnabledLevel();
+
 	//! Обработать запись лога, передать другим модулям
 	void ProcessLog(std::shared_ptr<LogEntry> logEntry);
 
 	//! Открыть файл на запись
 	bool OpenFile();
+	//! Нужно ли начинать новый сегмент
+	bool IsRotationRequired() const;
+	//! Начать новый сегмент: новый файл открывается до закрытия старого,
+	//! закрытый сегмент передаётся на сжатие
+	void RotateFile();
+	//! Имя файла для нового сегмента
+	std::string MakeFilePath() const;
 };
 
 template <typename... Args>
-void Logger::Log(PriorityEnum aPriority, std::string aFile, std::string aFunction, int aLine, std::string format,
+void Logger::Log(PriorityEnum aPriority, const char* aFile, const char* aFunction, int aLine, const char* format,
                  Args&&... vs)
 {
-	if (aPriority < mLogLevel)
+	if (!IsEnabled(aPriority))
 	{
 		return;
 	}
 
-	// собираем сообщение
-	const std::string messageText = Utils::Format(format.c_str(), vs...);
-	// получаем короткое имя файла
-	std::string fileString = Utils::GetFileNameWithExtension(aFile);
+	const std::chrono::system_clock::time_point now = std::chrono::system_clock::now();
 
-	// лочимся
-	std::lock_guard<std::mutex> lock(mMutex);
-	// собираем запись лога
-	std::shared_ptr<LogEntry> logEntry = std::make_shared<LogEntry>(std::chrono::system_clock::now(), aPriority,
-	                                                                messageText, fileString, aFunction, aLine);
-	// фильтруем идущие друг за другом одинаковые сообщения
-	bool repeatedLogEntry = false, replaceLogEntry = true;
-	if (logEntry->Message.compare(mLastLogEntry.Message) == 0)
-	{
-		++mLastLogEntry.Counter;
-		mLastLogEntry.Time = logEntry->Time;
-		replaceLogEntry = false;
-		repeatedLogEntry = true;
-	}
-	else if (mLastLogEntry.Counter > 0)
+	// собираем сообщение во временный буфер, без выделения памяти
+	char buffer[FlightRecorder::MessageSize];
+	const int length = std::snprintf(buffer, sizeof(buffer), format, vs...);
+	if (aPriority >= mFlightRecorderLevel.load(std::memory_order_relaxed))
 	{
-		// пишем то что повторялось один разик с указанием кол-ва повторов
-		ProcessLog(std::make_shared<LogEntry>(mLastLogEntry));
-		mLastLogEntry.Counter = 0;
+		mFlightRecorder.Record(static_cast<int>(aPriority), now, aFile, aFunction, aLine, buffer);
 	}
-	if (!repeatedLogEntry)
+	if (aPriority < mLogLevel.load(std::memory_order_relaxed))
 	{
-		// пишем то что ещё не повторялось
-		ProcessLog(logEntry);
-	}
-	if (replaceLogEntry)
-	{
-		mLastLogEntry = *logEntry;
+		return;
 	}
+
+	// длинные сообщения собираем заново целиком
+	const std::string messageText = length >= 0 && static_cast<size_t>(length) < sizeof(buffer)
+		? std::string(buffer, static_cast<size_t>(length))
+		: Utils::Format(format, vs...);
+	// получаем короткое имя файла
+	std::string fileString = Utils::GetFileNameWithExtension(aFile);
+
+	WriteEntry(aPriority, now, fileString, aFunction, aLine, messageText);
+}
+
+template <typename... Args>
+void Logger::Log(PriorityEnum aPriority, const char* aFile, const char* aFunction, int aLine, const std::string& format,
+                 Args&&... vs)
+{
+	Log(aPriority, aFile, aFunction, aLine, format.c_str(), std::forward<Args>(vs)...);
 }
 
+// Уровень проверяется до вычисления аргументов; при приоритете ниже LOGGER_MIN_LEVEL
+// условие известно при компиляции и вызов удаляется целиком.
+// Формат должен быть C-строкой: он и аргументы проверяются компилятором через Utils::CheckFormat
 #ifdef _WIN32
 
 #define LOGGER_LOG(priority, format, ...) \
-    Logger::Instance().Log(priority, __FILE__, __func__, __LINE__, format, __VA_ARGS__)
-
-#define LOGGER_NULLPTR(name) \
-    Logger::Instance().Log(PriorityEnum::Error, __FILE__, __func__, __LINE__, "%s(%d): %s is nullptr", name)
+    do { \
+        if (false) \
+            ::Fatracing::Utils::CheckFormat(format, __VA_ARGS__); \
+        if (static_cast<int>(priority) >= LOGGER_MIN_LEVEL && ::Fatracing::Logger::Instance().IsEnabled(priority)) \
+            ::Fatracing::Logger::Instance().Log(priority, __FILE__, __func__, __LINE__, format, __VA_ARGS__); \
+    } while (0)
 
 #elif __linux__
 
 #define LOGGER_LOG(priority, format, ...) \
-    Logger::Instance().Log(priority, __FILE__, __func__, __LINE__, format, ##__VA_ARGS__)
+    do { \
+        if (false) \
+            ::Fatracing::Utils::CheckFormat(format, ##__VA_ARGS__); \
+        if (static_cast<int>(priority) >= LOGGER_MIN_LEVEL && ::Fatracing::Logger::Instance().IsEnabled(priority)) \
+            ::Fatracing::Logger::Instance().Log(priority, __FILE__, __func__, __LINE__, format, ##__VA_ARGS__); \
+    } while (0)
 
-//Logger::template LogStatic<args>(priority, "", "", "", format)
+#endif
 
 #define LOGGER_NULLPTR(name) \
-    Logger::Instance().Log(PriorityEnum::Error, __FILE__, __func__, __LINE__, "%s(%d): %s is nullptr", name)
+    LOGGER_LOG(::Fatracing::PriorityEnum::Error, "%s is nullptr", name)
+
+// Макросы по уровням: ниже LOGGER_MIN_LEVEL раскрываются в пустой оператор
+#if LOGGER_MIN_LEVEL <= 0
+#define LOGGER_TRACE(...) LOGGER_LOG(::Fatracing::PriorityEnum::Trace, __VA_ARGS__)
+#else
+#define LOGGER_TRACE(...) do {} while (0)
+#endif
 
+#if LOGGER_MIN_LEVEL <= 1
+#define LOGGER_DEBUG(...) LOGGER_LOG(::Fatracing::PriorityEnum::Debug, __VA_ARGS__)
+#else
+#define LOGGER_DEBUG(...) do {} while (0)
 #endif
 
+#if LOGGER_MIN_LEVEL <= 2
+#define LOGGER_INFO(...) LOGGER_LOG(::Fatracing::PriorityEnum::Info, __VA_ARGS__)
+#else
+#define LOGGER_INFO(...) do {} while (0)
+#endif
+
+#if LOGGER_MIN_LEVEL <= 3
+#define LOGGER_WARNING(...) LOGGER_LOG(::Fatracing::PriorityEnum::Warning, __VA_ARGS__)
+#else
+#define LOGGER_WARNING(...) do {} while (0)
+#endif
+
+#define LOGGER_ERROR(...) LOGGER_LOG(::Fatracing::PriorityEnum::Error, __VA_ARGS__)
+
 } // namespace Fatracing
 
 #endif // LOGGER_H_
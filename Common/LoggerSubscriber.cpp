@@ -0,0 +1,46 @@
+// Copyright 2018
+
+#include "LoggerSubscriber.h"
+
+namespace Fatracing {
+
+LoggerSubscriber::LoggerSubscriber(Logger::LoggerCallback aCallback, size_t aMaxQueueSize, LogDropPolicy aDropPolicy) :
+	mCallback(aCallback),
+	mMaxQueueSize(aMaxQueueSize),
+	mDropPolicy(aDropPolicy) {
+}
+
+LoggerSubscriber::~LoggerSubscriber() {
+	// останавливаем поток до разрушения коллбека
+	StopThread();
+}
+
+bool LoggerSubscriber::Start() {
+	return StartThread();
+}
+
+bool LoggerSubscriber::Push(std::shared_ptr<Logger::LogEntry> aLogEntry) {
+	switch (mDropPolicy) {
+		case LogDropPolicy::DropNewest:
+			return AddItemSkip(aLogEntry, mMaxQueueSize);
+		case LogDropPolicy::DropOldest:
+		default:
+			return AddItem(aLogEntry, mMaxQueueSize);
+	}
+}
+
+size_t LoggerSubscriber::GetQueueSize() {
+	return AsyncQueue<Logger::LogEntry>::GetQueueSize();
+}
+
+uint64_t LoggerSubscriber::GetDroppedCount() const {
+	return AsyncQueue<Logger::LogEntry>::GetDroppedCount();
+}
+
+void LoggerSubscriber::HandleWorkItem(std::shared_ptr<Logger::LogEntry> aItem) {
+	if (mCallback) {
+		mCallback(aItem);
+	}
+}
+
+} // namespace Fatracing
@@ -0,0 +1,46 @@
+// Copyright 2018
+
+#ifndef COMMON_LOGGER_SUBSCRIBER_H_
+#define COMMON_LOGGER_SUBSCRIBER_H_
+
+#include "AsyncQueue.h"
+#include "Logger.h"
+
+namespace Fatracing
+{
+//! Подписчик логгера: собственная ограниченная очередь и поток, на котором вызывается коллбек.
+//! Медленный подписчик (GUI, запись сессии на диск) не задерживает потоки, которые пишут лог.
+class LoggerSubscriber : protected AsyncQueue<Logger::LogEntry>
+{
+	//! Коллбек подписчика
+	Logger::LoggerCallback mCallback;
+	//! Максимальный размер очереди
+	size_t mMaxQueueSize;
+	//! Что делать при переполнении очереди
+	LogDropPolicy mDropPolicy;
+
+public:
+	//! Конструктор
+	//! @param aCallback коллбек, вызывается на потоке подписчика
+	//! @param aMaxQueueSize максимальный размер очереди (0 - без ограничения)
+	//! @param aDropPolicy что делать при переполнении очереди
+	LoggerSubscriber(Logger::LoggerCallback aCallback, size_t aMaxQueueSize, LogDropPolicy aDropPolicy);
+	//! Деструктор, дожидается завершения потока
+	~LoggerSubscriber();
+
+	//! Запустить поток подписчика
+	bool Start();
+	//! Поставить запись в очередь подписчика, false если запись отброшена
+	bool Push(std::shared_ptr<Logger::LogEntry> aLogEntry);
+
+	//! Количество записей в очереди
+	size_t GetQueueSize();
+	//! Количество отброшенных записей
+	uint64_t GetDroppedCount() const;
+
+protected:
+	void HandleWorkItem(std::shared_ptr<Logger::LogEntry> aItem) override;
+};
+} // namespace Fatracing
+
+#endif // COMMON_LOGGER_SUBSCRIBER_H_
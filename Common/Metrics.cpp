@@ -0,0 +1,237 @@
+// Copyright 2018
+
+#include "Metrics.h"
+
+#include <algorithm>
+#include <cstdio>
+
+#include "BinaryLog.h"
+#include "Logger.h"
+#include "ProcessStats.h"
+
+namespace Fatracing
+{
+namespace
+{
+//! Число в формате Prometheus (целые без дробной части)
+std::string FormatValue(double aValue)
+{
+	char buffer[64];
+	if (aValue == static_cast<double>(static_cast<int64_t>(aValue)))
+	{
+		std::snprintf(buffer, sizeof(buffer), "%lld", static_cast<long long>(aValue));
+	}
+	else
+	{
+		std::snprintf(buffer, sizeof(buffer), "%.9g", aValue);
+	}
+	return buffer;
+}
+
+//! Имя серии с метками: name{labels,extra}
+std::string SeriesName(const std::string& aName, const std::string& aLabels, const std::string& aExtra = "")
+{
+	if (aLabels.empty() && aExtra.empty())
+	{
+		return aName;
+	}
+	std::string result = aName + "{" + aLabels;
+	if (!aLabels.empty() && !aExtra.empty())
+	{
+		result += ",";
+	}
+	return result + aExtra + "}";
+}
+} // namespace
+
+MetricHistogram::MetricHistogram(const std::vector<double>& aBounds) :
+	mBounds(aBounds),
+	mCounts(new std::atomic<uint64_t>[aBounds.size() + 1])
+{
+	std::sort(mBounds.begin(), mBounds.end());
+	for (double bound : mBounds)
+	{
+		mBoundsNs.push_back(static_cast<int64_t>(bound * 1e9));
+	}
+	for (size_t i = 0; i <= mBounds.size(); ++i)
+	{
+		mCounts[i] = 0;
+	}
+}
+
+void MetricHistogram::Observe(std::chrono::nanoseconds aValue)
+{
+	const int64_t ns = std::max<int64_t>(aValue.count(), 0);
+	const size_t index = std::lower_bound(mBoundsNs.begin(), mBoundsNs.end(), ns) - mBoundsNs.begin();
+	mCounts[index].fetch_add(1, std::memory_order_relaxed);
+	mSumNs.fetch_add(static_cast<uint64_t>(ns), std::memory_order_relaxed);
+}
+
+Metrics& Metrics::Instance()
+{
+	static Metrics instance;
+	return instance;
+}
+
+Metrics::Series* Metrics::Find(const std::string& aName, const std::string& aLabels)
+{
+	for (auto& series : mSeries)
+	{
+		if (series->Name == aName && series->Labels == aLabels)
+		{
+			return series.get();
+		}
+	}
+	return nullptr;
+}
+
+Metrics::Series& Metrics::Add(const std::string& aName, const std::string& aHelp, const std::string& aLabels, Type aType)
+{
+	std::unique_ptr<Series> series(new Series());
+	series->Name = aName;
+	series->Help = aHelp;
+	series->Labels = aLabels;
+	series->MetricType = aType;
+	// серии одного семейства выводятся подряд, под общими HELP и TYPE
+	auto last = std::find_if(mSeries.rbegin(), mSeries.rend(), [&](const std::unique_ptr<Series>& aSeries) {
+		return aSeries->Name == aName;
+	});
+	Series& result = *series;
+	mSeries.insert(last == mSeries.rend() ? mSeries.end() : last.base(), std::move(series));
+	return result;
+}
+
+MetricCounter& Metrics::AddCounter(const std::string& aName, const std::string& aHelp, const std::string& aLabels)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	Series* series = Find(aName, aLabels);
+	if (!series)
+	{
+		series = &Add(aName, aHelp, aLabels, Type::Counter);
+		series->Counter.reset(new MetricCounter());
+	}
+	return *series->Counter;
+}
+
+MetricGauge& Metrics::AddGauge(const std::string& aName, const std::string& aHelp, const std::string& aLabels)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	Series* series = Find(aName, aLabels);
+	if (!series)
+	{
+		series = &Add(aName, aHelp, aLabels, Type::Gauge);
+		series->Gauge.reset(new MetricGauge());
+	}
+	return *series->Gauge;
+}
+
+MetricHistogram& Metrics::AddHistogram(const std::string& aName, const std::string& aHelp,
+                                       const std::vector<double>& aBounds, const std::string& aLabels)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	Series* series = Find(aName, aLabels);
+	if (!series)
+	{
+		series = &Add(aName, aHelp, aLabels, Type::Histogram);
+		series->Histogram.reset(new MetricHistogram(aBounds));
+	}
+	return *series->Histogram;
+}
+
+void Metrics::AddCallback(const std::string& aName, const std::string& aHelp, bool aIsCounter,
+                          std::function<double()> aCallback, const std::string& aLabels)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	Series* series = Find(aName, aLabels);
+	if (!series)
+	{
+		series = &Add(aName, aHelp, aLabels, aIsCounter ? Type::Counter : Type::Gauge);
+	}
+	series->Callback = std::move(aCallback);
+}
+
+std::string Metrics::Render()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	std::string result;
+	const std::string* family = nullptr;
+	for (const auto& series : mSeries)
+	{
+		if (!family || *family != series->Name)
+		{
+			family = &series->Name;
+			static const char* typeNames[] = {"counter", "gauge", "histogram"};
+			result += "# HELP " + series->Name + " " + series->Help + "\n";
+			result += "# TYPE " + series->Name + " " + typeNames[static_cast<int>(series->MetricType)] + "\n";
+		}
+
+		if (series->Callback)
+		{
+			result += SeriesName(series->Name, series->Labels) + " " + FormatValue(series->Callback()) + "\n";
+		}
+		else if (series->Counter)
+		{
+			result += SeriesName(series->Name, series->Labels) + " " +
+			          FormatValue(static_cast<double>(series->Counter->Value())) + "\n";
+		}
+		else if (series->Gauge)
+		{
+			result += SeriesName(series->Name, series->Labels) + " " +
+			          FormatValue(static_cast<double>(series->Gauge->Value())) + "\n";
+		}
+		else if (series->Histogram)
+		{
+			const MetricHistogram& histogram = *series->Histogram;
+			uint64_t cumulative = 0;
+			for (size_t i = 0; i < histogram.Bounds().size(); ++i)
+			{
+				cumulative += histogram.BucketCount(i);
+				result += SeriesName(series->Name + "_bucket", series->Labels,
+				                     "le=\"" + FormatValue(histogram.Bounds()[i]) + "\"") +
+				          " " + FormatValue(static_cast<double>(cumulative)) + "\n";
+			}
+			cumulative += histogram.BucketCount(histogram.Bounds().size());
+			result += SeriesName(series->Name + "_bucket", series->Labels, "le=\"+Inf\"") + " " +
+			          FormatValue(static_cast<double>(cumulative)) + "\n";
+			result += SeriesName(series->Name + "_sum", series->Labels) + " " +
+			          FormatValue(histogram.SumSeconds()) + "\n";
+			result += SeriesName(series->Name + "_count", series->Labels) + " " +
+			          FormatValue(static_cast<double>(cumulative)) + "\n";
+		}
+	}
+	return result;
+}
+
+void Metrics::RegisterProcessMetrics()
+{
+	AddCallback("fatracing_log_queue_depth", "Records waiting in the logger subscriber queue", false, []() {
+		return static_cast<double>(Logger::Instance().GetCallbackQueueSize());
+	});
+	AddCallback("fatracing_log_dropped_total", "Log records dropped because a queue was full", true, []() {
+		return static_cast<double>(Logger::Instance().GetCallbackDroppedCount());
+	}, "log=\"text\"");
+	AddCallback("fatracing_log_dropped_total", "Log records dropped because a queue was full", true, []() {
+		return static_cast<double>(BinaryLogger::Instance().GetDroppedCount());
+	}, "log=\"binary\"");
+	AddCallback("fatracing_process_resident_bytes", "Resident memory of the process", false, []() {
+		ProcessStats stats;
+		ProcessStats::Read(stats);
+		return static_cast<double>(stats.ResidentBytes);
+	});
+	AddCallback("fatracing_process_threads", "Threads of the process", false, []() {
+		ProcessStats stats;
+		ProcessStats::Read(stats);
+		return static_cast<double>(stats.Threads);
+	});
+	AddCallback("fatracing_process_open_fds", "Open file descriptors of the process", false, []() {
+		ProcessStats stats;
+		ProcessStats::Read(stats);
+		return static_cast<double>(stats.OpenFiles);
+	});
+}
+
+std::vector<double> Metrics::LatencyBounds()
+{
+	return {0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1.0, 2.5, 10.0};
+}
+} // namespace Fatracing
@@ -0,0 +1,118 @@
+// Copyright 2018
+
+#ifndef COMMON_METRICS_H_
+#define COMMON_METRICS_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace Fatracing
+{
+//! Счётчик (монотонно растёт). Увеличение - одна атомарная операция.
+class MetricCounter
+{
+	std::atomic<uint64_t> mValue{0};
+
+public:
+	void Increment(uint64_t aDelta = 1) { mValue.fetch_add(aDelta, std::memory_order_relaxed); }
+	uint64_t Value() const { return mValue.load(std::memory_order_relaxed); }
+};
+
+//! Значение, которое может расти и уменьшаться
+class MetricGauge
+{
+	std::atomic<int64_t> mValue{0};
+
+public:
+	void Set(int64_t aValue) { mValue.store(aValue, std::memory_order_relaxed); }
+	void Add(int64_t aDelta) { mValue.fetch_add(aDelta, std::memory_order_relaxed); }
+	int64_t Value() const { return mValue.load(std::memory_order_relaxed); }
+};
+
+//! Гистограмма длительностей с фиксированными границами корзин (в секундах).
+//! Запись - поиск корзины и две атомарные операции.
+class MetricHistogram
+{
+	std::vector<double> mBounds;
+	std::vector<int64_t> mBoundsNs;
+	std::unique_ptr<std::atomic<uint64_t>[]> mCounts;
+	std::atomic<uint64_t> mSumNs{0};
+
+public:
+	//! @param aBounds верхние границы корзин в секундах, по возрастанию
+	explicit MetricHistogram(const std::vector<double>& aBounds);
+
+	void Observe(std::chrono::nanoseconds aValue);
+
+	const std::vector<double>& Bounds() const { return mBounds; }
+	//! Количество значений в корзине (последняя - больше всех границ)
+	uint64_t BucketCount(size_t aIndex) const { return mCounts[aIndex].load(std::memory_order_relaxed); }
+	double SumSeconds() const { return mSumNs.load(std::memory_order_relaxed) / 1e9; }
+};
+
+//! Реестр метрик процесса и их вывод в текстовом формате Prometheus.
+//! Метрики создаются один раз (обычно при создании модуля) и живут до конца процесса,
+//! поэтому модули хранят ссылки на них и на горячем пути только увеличивают атомарные значения.
+//! Повторная регистрация с тем же именем и метками возвращает ту же метрику.
+class Metrics
+{
+	enum class Type
+	{
+		Counter,
+		Gauge,
+		Histogram
+	};
+
+	struct Series
+	{
+		std::string Name;
+		std::string Help;
+		//! Метки в формате Prometheus без фигурных скобок: lane="blue"
+		std::string Labels;
+		Type MetricType;
+		std::unique_ptr<MetricCounter> Counter;
+		std::unique_ptr<MetricGauge> Gauge;
+		std::unique_ptr<MetricHistogram> Histogram;
+		//! Значение, вычисляемое в момент выгрузки (глубина очередей и т.п.)
+		std::function<double()> Callback;
+	};
+
+	std::mutex mMutex;
+	std::vector<std::unique_ptr<Series>> mSeries;
+
+	Metrics() = default;
+
+public:
+	//! Получить экземпляр синглтона
+	static Metrics& Instance();
+
+	MetricCounter& AddCounter(const std::string& aName, const std::string& aHelp, const std::string& aLabels = "");
+	MetricGauge& AddGauge(const std::string& aName, const std::string& aHelp, const std::string& aLabels = "");
+	MetricHistogram& AddHistogram(const std::string& aName, const std::string& aHelp,
+	                              const std::vector<double>& aBounds, const std::string& aLabels = "");
+	//! Значение, которое вычисляется при каждой выгрузке
+	void AddCallback(const std::string& aName, const std::string& aHelp, bool aIsCounter,
+	                 std::function<double()> aCallback, const std::string& aLabels = "");
+
+	//! Все метрики в текстовом формате Prometheus (version 0.0.4)
+	std::string Render();
+
+	//! Зарегистрировать общие метрики процесса: очереди и потери логгера, память, потоки, дескрипторы
+	void RegisterProcessMetrics();
+
+	//! Границы корзин по умолчанию для задержек: 100 мкс ... 10 с
+	static std::vector<double> LatencyBounds();
+
+private:
+	Series* Find(const std::string& aName, const std::string& aLabels);
+	Series& Add(const std::string& aName, const std::string& aHelp, const std::string& aLabels, Type aType);
+};
+} // namespace Fatracing
+
+#endif // COMMON_METRICS_H_
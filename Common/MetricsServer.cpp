@@ -0,0 +1,199 @@
+// Copyright 2018
+
+#include "MetricsServer.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#include "Logger.h"
+#include "Metrics.h"
+#include "Trace.h"
+
+namespace Fatracing
+{
+MetricsServer::MetricsServer()
+{
+}
+
+MetricsServer::~MetricsServer()
+{
+	Stop();
+}
+
+bool MetricsServer::Start(const std::string& aAddress)
+{
+	Stop();
+	static const std::string unixPrefix = "unix:";
+	bool opened = false;
+	if (aAddress.compare(0, unixPrefix.size(), unixPrefix) == 0)
+	{
+		opened = OpenUnix(aAddress.substr(unixPrefix.size()));
+	}
+	else
+	{
+		const size_t colon = aAddress.rfind(':');
+		const std::string host = colon == std::string::npos ? "127.0.0.1" : aAddress.substr(0, colon);
+		const int port = std::atoi(aAddress.c_str() + (colon == std::string::npos ? 0 : colon + 1));
+		opened = OpenTcp(host, port);
+	}
+	if (!opened)
+	{
+		return false;
+	}
+	mAddress = aAddress;
+	LOGGER_LOG(PriorityEnum::Info, "Метрики доступны по адресу %s", mAddress.c_str());
+	return StartThread();
+}
+
+void MetricsServer::Stop()
+{
+	StopThread();
+	if (mSocket >= 0)
+	{
+		close(mSocket);
+		mSocket = -1;
+	}
+	if (!mUnixPath.empty())
+	{
+		unlink(mUnixPath.c_str());
+		mUnixPath.clear();
+	}
+}
+
+bool MetricsServer::OpenTcp(const std::string& aHost, int aPort)
+{
+	sockaddr_in address;
+	std::memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_port = htons(static_cast<uint16_t>(aPort));
+	if (aPort <= 0 || aPort > 65535 || inet_pton(AF_INET, aHost.c_str(), &address.sin_addr) != 1)
+	{
+		LOGGER_LOG(PriorityEnum::Error, "Неверный адрес для метрик: \"%s:%d\"", aHost.c_str(), aPort);
+		return false;
+	}
+	// метрики не должны быть видны снаружи
+	if ((ntohl(address.sin_addr.s_addr) >> 24) != 127)
+	{
+		LOGGER_LOG(PriorityEnum::Error, "Метрики отдаются только на loopback, адрес \"%s\" не подходит", aHost.c_str());
+		return false;
+	}
+
+	mSocket = socket(AF_INET, SOCK_STREAM, 0);
+	if (mSocket < 0)
+	{
+		LOGGER_LOG(PriorityEnum::Error, "Не удалось создать сокет для метрик: %s", std::strerror(errno));
+		return false;
+	}
+	const int reuse = 1;
+	setsockopt(mSocket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+	if (bind(mSocket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(mSocket, 8) != 0)
+	{
+		LOGGER_LOG(PriorityEnum::Error, "Не удалось открыть порт %d для метрик: %s", aPort, std::strerror(errno));
+		close(mSocket);
+		mSocket = -1;
+		return false;
+	}
+	return true;
+}
+
+bool MetricsServer::OpenUnix(const std::string& aPath)
+{
+	sockaddr_un address;
+	std::memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if (aPath.empty() || aPath.size() >= sizeof(address.sun_path))
+	{
+		LOGGER_LOG(PriorityEnum::Error, "Неверный путь сокета для метрик: \"%s\"", aPath.c_str());
+		return false;
+	}
+	std::strncpy(address.sun_path, aPath.c_str(), sizeof(address.sun_path) - 1);
+
+	mSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (mSocket < 0)
+	{
+		LOGGER_LOG(PriorityEnum::Error, "Не удалось создать сокет для метрик: %s", std::strerror(errno));
+		return false;
+	}
+	// сокет мог остаться от предыдущего запуска
+	unlink(aPath.c_str());
+	if (bind(mSocket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(mSocket, 8) != 0)
+	{
+		LOGGER_LOG(PriorityEnum::Error, "Не удалось открыть сокет \"%s\" для метрик: %s", aPath.c_str(), std::strerror(errno));
+		close(mSocket);
+		mSocket = -1;
+		return false;
+	}
+	mUnixPath = aPath;
+	return true;
+}
+
+void MetricsServer::ThreadFunc()
+{
+	Tracer::Instance().SetThreadName("MetricsServer");
+	while (IsThreadActive())
+	{
+		pollfd pfd = {mSocket, POLLIN, 0};
+		if (poll(&pfd, 1, AcceptTimeoutMs) <= 0)
+		{
+			continue;
+		}
+		const int client = accept(mSocket, nullptr, nullptr);
+		if (client < 0)
+		{
+			continue;
+		}
+		Serve(client);
+		close(client);
+	}
+}
+
+void MetricsServer::Serve(int aClient)
+{
+	// запрос не разбираем: достаточно дождаться его заголовков, чтобы клиент не получил RST
+	char request[1024];
+	size_t received = 0;
+	while (received < sizeof(request))
+	{
+		pollfd pfd = {aClient, POLLIN, 0};
+		if (poll(&pfd, 1, AcceptTimeoutMs) <= 0)
+		{
+			break;
+		}
+		const ssize_t size = recv(aClient, request + received, sizeof(request) - received, 0);
+		if (size <= 0)
+		{
+			break;
+		}
+		received += static_cast<size_t>(size);
+		if (std::string(request, received).find("\r\n\r\n") != std::string::npos)
+		{
+			break;
+		}
+	}
+
+	const std::string body = Metrics::Instance().Render();
+	const std::string response =
+		"HTTP/1.0 200 OK\r\n"
+		"Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+		"Content-Length: " + std::to_string(body.size()) + "\r\n"
+		"Connection: close\r\n\r\n" + body;
+	size_t sent = 0;
+	while (sent < response.size())
+	{
+		const ssize_t size = send(aClient, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+		if (size <= 0)
+		{
+			break;
+		}
+		sent += static_cast<size_t>(size);
+	}
+}
+} // namespace Fatracing
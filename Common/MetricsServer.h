@@ -0,0 +1,49 @@
+// Copyright 2018
+
+#ifndef COMMON_METRICS_SERVER_H_
+#define COMMON_METRICS_SERVER_H_
+
+#include <string>
+
+#include "BaseThread.h"
+
+namespace Fatracing
+{
+//! Отдача метрик (Metrics::Render) по HTTP на отдельном потоке.
+//! Слушает только локальный адрес (127.0.0.1:<port>) или Unix-сокет (unix:<path>),
+//! на любой запрос отвечает текущими метриками в текстовом формате Prometheus.
+//! Горячий путь сервер не затрагивает: метрики считываются только в момент запроса.
+class MetricsServer : protected BaseThread
+{
+	//! Как часто поток проверяет флаг остановки, мс
+	static const int AcceptTimeoutMs = 200;
+
+	int mSocket = -1;
+	std::string mAddress;
+	std::string mUnixPath;
+
+public:
+	MetricsServer();
+	~MetricsServer();
+
+	//! Открыть сокет и запустить поток
+	//! @param aAddress "<port>", "127.0.0.1:<port>" или "unix:<path>"
+	//! @return false, если адрес неверный или сокет не открылся
+	bool Start(const std::string& aAddress);
+	//! Остановить поток и закрыть сокет
+	void Stop();
+
+	//! Адрес, на котором слушает сервер
+	const std::string& GetAddress() const { return mAddress; }
+
+protected:
+	void ThreadFunc() override;
+
+private:
+	bool OpenTcp(const std::string& aHost, int aPort);
+	bool OpenUnix(const std::string& aPath);
+	void Serve(int aClient);
+};
+} // namespace Fatracing
+
+#endif // COMMON_METRICS_SERVER_H_
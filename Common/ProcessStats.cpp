@@ -0,0 +1,74 @@
+// Copyright 2018
+
+#include "ProcessStats.h"
+
+#ifdef __linux__
+#include <dirent.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstring>
+#endif
+
+namespace Fatracing
+{
+bool ProcessStats::Read(ProcessStats& aStats)
+{
+#ifdef __linux__
+	aStats = ProcessStats();
+
+	std::FILE* statm = std::fopen("/proc/self/statm", "r");
+	if (!statm)
+	{
+		return false;
+	}
+	unsigned long long sizePages = 0;
+	unsigned long long residentPages = 0;
+	const int fields = std::fscanf(statm, "%llu %llu", &sizePages, &residentPages);
+	std::fclose(statm);
+	if (fields != 2)
+	{
+		return false;
+	}
+	aStats.ResidentBytes = residentPages * static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+
+	std::FILE* status = std::fopen("/proc/self/status", "r");
+	if (status)
+	{
+		char line[256];
+		while (std::fgets(line, sizeof(line), status))
+		{
+			unsigned int threads = 0;
+			if (std::sscanf(line, "Threads: %u", &threads) == 1)
+			{
+				aStats.Threads = threads;
+				break;
+			}
+		}
+		std::fclose(status);
+	}
+
+	DIR* fds = opendir("/proc/self/fd");
+	if (fds)
+	{
+		while (dirent* entry = readdir(fds))
+		{
+			if (entry->d_name[0] != '.')
+			{
+				++aStats.OpenFiles;
+			}
+		}
+		closedir(fds);
+		// дескриптор самого opendir
+		if (aStats.OpenFiles > 0)
+		{
+			--aStats.OpenFiles;
+		}
+	}
+	return true;
+#else
+	(void)aStats;
+	return false;
+#endif
+}
+} // namespace Fatracing
@@ -0,0 +1,25 @@
+// Copyright 2018
+
+#ifndef COMMON_PROCESS_STATS_H_
+#define COMMON_PROCESS_STATS_H_
+
+#include <cstdint>
+
+namespace Fatracing
+{
+//! Ресурсы, занятые процессом
+struct ProcessStats
+{
+	//! Резидентная память, байт
+	uint64_t ResidentBytes = 0;
+	//! Количество потоков
+	uint32_t Threads = 0;
+	//! Количество открытых файловых дескрипторов
+	uint32_t OpenFiles = 0;
+
+	//! Прочитать для текущего процесса (Linux, /proc/self), false если недоступно
+	static bool Read(ProcessStats& aStats);
+};
+} // namespace Fatracing
+
+#endif // COMMON_PROCESS_STATS_H_
@@ -0,0 +1,64 @@
+// Copyright 2018
+
+#ifndef COMMON_RING_BUFFER_H_
+#define COMMON_RING_BUFFER_H_
+
+#include <cstddef>
+#include <vector>
+
+namespace Fatracing
+{
+//! Кольцевой буфер фиксированной ёмкости.
+//! Память выделяется один раз в конструкторе, при заполнении новые элементы затирают самые старые.
+//! Индексация от самого старого элемента (0) к самому новому (Size() - 1). Не потокобезопасен.
+template <typename T>
+class RingBuffer
+{
+	std::vector<T> mItems;
+	size_t mHead = 0;
+	size_t mSize = 0;
+	//! Сколько элементов было добавлено за всё время
+	size_t mTotal = 0;
+
+public:
+	//! Конструктор
+	//! @param aCapacity ёмкость буфера, больше 0
+	explicit RingBuffer(size_t aCapacity) : mItems(aCapacity) {}
+
+	//! Добавить элемент, при заполнении затирает самый старый
+	void Push(const T& aItem)
+	{
+		mItems[(mHead + mSize) % mItems.size()] = aItem;
+		if (mSize < mItems.size())
+		{
+			++mSize;
+		}
+		else
+		{
+			mHead = (mHead + 1) % mItems.size();
+		}
+		++mTotal;
+	}
+
+	//! Очистить
+	void Clear()
+	{
+		mHead = 0;
+		mSize = 0;
+		mTotal = 0;
+	}
+
+	//! Элемент по индексу от самого старого
+	const T& operator[](size_t aIndex) const { return mItems[(mHead + aIndex) % mItems.size()]; }
+	//! Самый новый элемент, буфер не должен быть пустым
+	const T& Back() const { return (*this)[mSize - 1]; }
+
+	size_t Size() const { return mSize; }
+	size_t Capacity() const { return mItems.size(); }
+	bool Empty() const { return mSize == 0; }
+	//! Сколько элементов было добавлено с последней очистки (включая затёртые)
+	size_t Total() const { return mTotal; }
+};
+} // namespace Fatracing
+
+#endif // COMMON_RING_BUFFER_H_
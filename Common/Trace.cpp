@@ -0,0 +1,186 @@
+// Copyright 2018
+
+#include "Trace.h"
+
+#include <algorithm>
+#include <fstream>
+
+namespace Fatracing {
+
+namespace {
+//! Экранирование строки для JSON
+std::string Escape(const std::string& aString) {
+	std::string result;
+	result.reserve(aString.size());
+	for (char c : aString) {
+		if (c == '"' || c == '\\') {
+			result += '\\';
+			result += c;
+		} else if (static_cast<unsigned char>(c) < 0x20) {
+			result += ' ';
+		} else {
+			result += c;
+		}
+	}
+	return result;
+}
+} // namespace
+
+struct Tracer::ThreadBufferOwner
+{
+	std::shared_ptr<ThreadBuffer> Buffer;
+
+	~ThreadBufferOwner() {
+		if (Buffer) {
+			Tracer::Instance().ReleaseThreadBuffer(Buffer);
+		}
+	}
+};
+
+Tracer::Tracer() {
+	mStartTime = Clock::now().time_since_epoch().count();
+}
+
+Tracer& Tracer::Instance() {
+	static Tracer instance;
+	return instance;
+}
+
+void Tracer::Start() {
+	mEnabled = false;
+	{
+		std::lock_guard<std::mutex> lock(mBuffersMutex);
+		// события завершившихся потоков больше не нужны вместе с их буферами
+		mBuffers.erase(std::remove_if(mBuffers.begin(), mBuffers.end(),
+			[](const std::shared_ptr<ThreadBuffer>& aBuffer) {
+				std::lock_guard<std::mutex> bufferLock(aBuffer->Mutex);
+				return aBuffer->Exited;
+			}), mBuffers.end());
+		for (auto& buffer : mBuffers) {
+			std::lock_guard<std::mutex> bufferLock(buffer->Mutex);
+			buffer->Events.clear();
+			buffer->Dropped = 0;
+		}
+		mStartTime = Clock::now().time_since_epoch().count();
+	}
+	mEnabled = true;
+}
+
+void Tracer::Stop() {
+	mEnabled = false;
+}
+
+void Tracer::SetThreadName(const std::string& aName) {
+	ThreadBuffer& buffer = GetThreadBuffer();
+	std::lock_guard<std::mutex> lock(buffer.Mutex);
+	buffer.ThreadName = aName;
+}
+
+void Tracer::Complete(const char* aCategory, const char* aName, Clock::time_point aBegin, Clock::time_point aEnd) {
+	Event event;
+	event.Name = aName;
+	event.Category = aCategory;
+	event.Phase = 'X';
+	event.TimestampUs = ToUs(aBegin);
+	event.DurationUs = std::chrono::duration_cast<std::chrono::microseconds>(aEnd - aBegin).count();
+	Add(event);
+}
+
+void Tracer::Instant(const char* aCategory, const char* aName) {
+	Event event;
+	event.Name = aName;
+	event.Category = aCategory;
+	event.Phase = 'i';
+	event.TimestampUs = ToUs(Clock::now());
+	event.DurationUs = 0;
+	Add(event);
+}
+
+int64_t Tracer::ToUs(Clock::time_point aTime) const {
+	const Clock::time_point startTime{Clock::duration(mStartTime.load(std::memory_order_relaxed))};
+	return std::chrono::duration_cast<std::chrono::microseconds>(aTime - startTime).count();
+}
+
+Tracer::ThreadBuffer& Tracer::GetThreadBuffer() {
+	static thread_local ThreadBufferOwner owner;
+	if (!owner.Buffer) {
+		std::shared_ptr<ThreadBuffer> buffer = std::make_shared<ThreadBuffer>();
+		std::lock_guard<std::mutex> lock(mBuffersMutex);
+		buffer->ThreadId = mNextThreadId++;
+		mBuffers.push_back(buffer);
+		owner.Buffer = buffer;
+	}
+	return *owner.Buffer;
+}
+
+void Tracer::ReleaseThreadBuffer(const std::shared_ptr<ThreadBuffer>& aBuffer) {
+	std::lock_guard<std::mutex> lock(mBuffersMutex);
+	std::lock_guard<std::mutex> bufferLock(aBuffer->Mutex);
+	if (aBuffer->Events.empty() && aBuffer->Dropped == 0) {
+		mBuffers.erase(std::remove(mBuffers.begin(), mBuffers.end(), aBuffer), mBuffers.end());
+	} else {
+		aBuffer->Exited = true;
+	}
+}
+
+void Tracer::Add(const Event& aEvent) {
+	ThreadBuffer& buffer = GetThreadBuffer();
+	// мьютекс буфера берёт только его поток, экспорт и Start - редко
+	std::lock_guard<std::mutex> lock(buffer.Mutex);
+	if (buffer.Events.capacity() == 0) {
+		// память под события - только у потоков, писавших при включённой трассировке
+		buffer.Events.reserve(ThreadBufferCapacity);
+	}
+	if (buffer.Events.size() < ThreadBufferCapacity) {
+		buffer.Events.push_back(aEvent);
+	} else {
+		++buffer.Dropped;
+	}
+}
+
+bool Tracer::ExportChromeJson(const std::string& aFilePath) {
+	std::ofstream file(aFilePath, std::ios::out | std::ios::trunc);
+	if (!file.is_open()) {
+		return false;
+	}
+
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	bool first = true;
+	auto separator = [&]() {
+		if (!first) {
+			file << ",\n";
+		}
+		first = false;
+	};
+
+	std::lock_guard<std::mutex> lock(mBuffersMutex);
+	for (auto& buffer : mBuffers) {
+		std::lock_guard<std::mutex> bufferLock(buffer->Mutex);
+		if (!buffer->ThreadName.empty()) {
+			separator();
+			file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->ThreadId
+			     << ",\"args\":{\"name\":\"" << Escape(buffer->ThreadName) << "\"}}";
+		}
+		for (const Event& event : buffer->Events) {
+			separator();
+			file << "{\"name\":\"" << Escape(event.Name) << "\",\"cat\":\"" << Escape(event.Category)
+			     << "\",\"ph\":\"" << event.Phase << "\",\"ts\":" << event.TimestampUs
+			     << ",\"pid\":1,\"tid\":" << buffer->ThreadId;
+			if (event.Phase == 'X') {
+				file << ",\"dur\":" << event.DurationUs;
+			} else {
+				file << ",\"s\":\"t\"";
+			}
+			file << "}";
+		}
+		if (buffer->Dropped > 0) {
+			separator();
+			file << "{\"name\":\"dropped events: " << buffer->Dropped << "\",\"cat\":\"trace\",\"ph\":\"i\",\"s\":\"t\""
+			     << ",\"ts\":0,\"pid\":1,\"tid\":" << buffer->ThreadId << "}";
+		}
+	}
+	file << "]}\n";
+	return static_cast<bool>(file);
+}
+
+} // namespace Fatracing
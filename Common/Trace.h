@@ -0,0 +1,148 @@
+// Copyright 2018
+
+#ifndef COMMON_TRACE_H_
+#define COMMON_TRACE_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace Fatracing
+{
+//! Трассировка работы потоков: интервалы и мгновенные события пишутся в буферы потоков
+//! и выгружаются в формате Chrome trace JSON (открывается в Perfetto / chrome://tracing).
+//! Пока трассировка выключена, TRACE_SCOPE стоит одно чтение атомарного флага.
+class Tracer
+{
+public:
+	//! Событие трассировки
+	struct Event
+	{
+		//! Имя (строковый литерал)
+		const char* Name;
+		//! Категория (строковый литерал)
+		const char* Category;
+		//! Тип события: 'X' - интервал, 'i' - мгновенное
+		char Phase;
+		//! Начало, мкс от запуска трассировки
+		int64_t TimestampUs;
+		//! Длительность, мкс
+		int64_t DurationUs;
+	};
+
+	typedef std::chrono::steady_clock Clock;
+
+private:
+	//! Буфер событий одного потока
+	struct ThreadBuffer
+	{
+		std::mutex Mutex;
+		std::vector<Event> Events;
+		uint64_t Dropped = 0;
+		uint32_t ThreadId = 0;
+		std::string ThreadName;
+		//! Поток завершился, события ждут экспорта или следующего Start
+		bool Exited = false;
+	};
+	//! Владелец буфера в thread_local: при завершении потока возвращает буфер трассировщику
+	struct ThreadBufferOwner;
+
+	//! Максимальное количество событий в буфере потока
+	static const size_t ThreadBufferCapacity = 1 << 16;
+
+	std::atomic<bool> mEnabled{false};
+	//! Время запуска трассировки (Clock::rep)
+	std::atomic<Clock::rep> mStartTime{0};
+
+	//! Мьютекс списка буферов
+	std::mutex mBuffersMutex;
+	//! Буферы потоков: живых и завершившихся с событиями (до экспорта или следующего Start).
+	//! Пустой буфер завершившегося потока удаляется сразу
+	std::vector<std::shared_ptr<ThreadBuffer>> mBuffers;
+	//! Номер следующего потока для просмотрщика
+	uint32_t mNextThreadId = 1;
+
+	Tracer();
+
+public:
+	//! Получить экземпляр синглтона
+	static Tracer& Instance();
+
+	//! Включить трассировку (ранее записанные события удаляются)
+	void Start();
+	//! Выключить трассировку
+	void Stop();
+	//! Включена ли трассировка
+	bool IsEnabled() const { return mEnabled.load(std::memory_order_relaxed); }
+
+	//! Задать имя текущего потока для просмотрщика
+	void SetThreadName(const std::string& aName);
+
+	//! Записать интервал
+	void Complete(const char* aCategory, const char* aName, Clock::time_point aBegin, Clock::time_point aEnd);
+	//! Записать мгновенное событие
+	void Instant(const char* aCategory, const char* aName);
+
+	//! Выгрузить события в файл Chrome trace JSON
+	bool ExportChromeJson(const std::string& aFilePath);
+
+private:
+	//! Буфер текущего потока (память под события выделяется при первом событии)
+	ThreadBuffer& GetThreadBuffer();
+	//! Поток завершился: пустой буфер удаляется, буфер с событиями остаётся для экспорта
+	void ReleaseThreadBuffer(const std::shared_ptr<ThreadBuffer>& aBuffer);
+	//! Добавить событие в буфер текущего потока
+	void Add(const Event& aEvent);
+	//! Время в мкс от запуска трассировки
+	int64_t ToUs(Clock::time_point aTime) const;
+};
+
+//! Интервал трассировки от конструктора до деструктора, используйте TRACE_SCOPE
+class TraceScope
+{
+	const char* mCategory;
+	const char* mName;
+	bool mEnabled;
+	Tracer::Clock::time_point mBegin;
+
+public:
+	TraceScope(const char* aCategory, const char* aName) :
+		mCategory(aCategory),
+		mName(aName),
+		mEnabled(Tracer::Instance().IsEnabled()) {
+		if (mEnabled) {
+			mBegin = Tracer::Clock::now();
+		}
+	}
+
+	~TraceScope() {
+		if (mEnabled) {
+			Tracer::Instance().Complete(mCategory, mName, mBegin, Tracer::Clock::now());
+		}
+	}
+
+	TraceScope(const TraceScope&) = delete;
+	TraceScope& operator=(const TraceScope&) = delete;
+};
+
+#define TRACE_CONCAT_IMPL(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_IMPL(a, b)
+
+//! Интервал до конца текущего блока
+#define TRACE_SCOPE(category, name) \
+    ::Fatracing::TraceScope TRACE_CONCAT(traceScope, __LINE__)(category, name)
+
+//! Мгновенное событие
+#define TRACE_INSTANT(category, name) \
+    do { \
+        if (::Fatracing::Tracer::Instance().IsEnabled()) \
+            ::Fatracing::Tracer::Instance().Instant(category, name); \
+    } while (0)
+
+} // namespace Fatracing
+
+#endif // COMMON_TRACE_H_
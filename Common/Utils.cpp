@@ -8,6 +8,55 @@
 namespace Fatracing {
 namespace Utils
 {
+std::string Format(const char* format, ...)
+{
+    char buffer[256];
+    va_list args;
+    va_start(args, format);
+    va_list argsCopy;
+    va_copy(argsCopy, args);
+    const int required = std::vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+
+    std::string result;
+    if (required < 0)
+    {
+        va_end(argsCopy);
+        return result;
+    }
+    if (static_cast<size_t>(required) < sizeof(buffer))
+    {
+        result.assign(buffer, static_cast<size_t>(required));
+    }
+    else
+    {
+        // не поместилось в буфер на стеке, собираем сразу в строку
+        result.resize(static_cast<size_t>(required) + 1);
+        std::vsnprintf(&result[0], result.size(), format, argsCopy);
+        result.resize(static_cast<size_t>(required));
+    }
+    va_end(argsCopy);
+    return result;
+}
+
+size_t FormatTo(char* aBuffer, size_t aSize, const char* format, ...)
+{
+    if (aSize == 0)
+    {
+        return 0;
+    }
+    va_list args;
+    va_start(args, format);
+    const int length = std::vsnprintf(aBuffer, aSize, format, args);
+    va_end(args);
+    if (length < 0)
+    {
+        aBuffer[0] = '\0';
+        return 0;
+    }
+    return static_cast<size_t>(length) < aSize ? static_cast<size_t>(length) : aSize - 1;
+}
+
 tm TimeToTimeT(const std::chrono::system_clock::time_point& time)
 {
     tm t;
@@ -15,9 +64,7 @@ tm TimeToTimeT(const std::chrono::system_clock::time_point& time)
 #ifdef _WIN32
     localtime_s(&t, &tt);
 #elif __linux__
-    tm* pointer;
-    pointer = localtime(&tt);
-    t = *pointer;
+    localtime_r(&tt, &t);
 #endif
     return t;
 }
@@ -36,13 +83,51 @@ std::chrono::system_clock::time_point TmToTimePoint(tm& aTm)
 
 std::string Format(const std::chrono::system_clock::time_point& time)
 {
+    char buffer[32];
+    return std::string(buffer, FormatTimestampTo(buffer, sizeof(buffer), time));
+}
+
+size_t FormatTimestampTo(char* aBuffer, size_t aSize, const std::chrono::system_clock::time_point& time)
+{
+    // "[YYYY-MM-DD HH:MM:SS." пересчитывается только при смене секунды
+    struct PrefixCache
+    {
+        time_t Second = -1;
+        char Prefix[32];
+        size_t Size = 0;
+    };
+    static thread_local PrefixCache cache;
+
+    const time_t second = std::chrono::system_clock::to_time_t(time);
+    if (second != cache.Second)
+    {
+        tm t = TimeToTimeT(time);
+        cache.Size = FormatTo(cache.Prefix, sizeof(cache.Prefix), "[%04u-%02u-%02u %02u:%02u:%02u.",
+                              static_cast<unsigned int>(t.tm_year + 1900), static_cast<unsigned int>(t.tm_mon + 1),
+                              static_cast<unsigned int>(t.tm_mday), static_cast<unsigned int>(t.tm_hour),
+                              static_cast<unsigned int>(t.tm_min), static_cast<unsigned int>(t.tm_sec));
+        cache.Second = second;
+    }
+
     auto tp = time.time_since_epoch();
     tp -= std::chrono::duration_cast<std::chrono::seconds>(tp);
+    const unsigned int milliseconds = static_cast<unsigned int>(tp / std::chrono::milliseconds(1)) % 1000;
 
-    tm t = TimeToTimeT(time);
-    return Format("[%04u-%02u-%02u %02u:%02u:%02u.%03u] ", t.tm_year + 1900,
-                  t.tm_mon + 1, t.tm_mday, t.tm_hour, t.tm_min, t.tm_sec,
-                  static_cast<unsigned int>(tp / std::chrono::milliseconds(1)));
+    // "[...." + "mmm] "
+    const size_t required = cache.Size + 5;
+    if (aSize <= required)
+    {
+        return FormatTo(aBuffer, aSize, "%s%03u] ", cache.Prefix, milliseconds);
+    }
+    std::memcpy(aBuffer, cache.Prefix, cache.Size);
+    char* tail = aBuffer + cache.Size;
+    tail[0] = static_cast<char>('0' + milliseconds / 100);
+    tail[1] = static_cast<char>('0' + milliseconds / 10 % 10);
+    tail[2] = static_cast<char>('0' + milliseconds % 10);
+    tail[3] = ']';
+    tail[4] = ' ';
+    tail[5] = '\0';
+    return required;
 }
 
 std::string FormatTimeShort(const std::chrono::system_clock::time_point& time)
@@ -8,6 +8,8 @@
 #include <string>
 #include <unordered_map>
 #include <stdarg.h>
+#include <cstdio>
+#include <cstring>
 #include <map>
 #include <iomanip>
 #include <boost/lexical_cast.hpp>
@@ -19,23 +21,71 @@
 namespace Fatracing {
 namespace Utils {
 
-template <typename... Args>
-std::string Format(const char* format, Args&&... vs)
+//! Проверка printf-формата компилятором (GCC/Clang)
+#if defined(__GNUC__) || defined(__clang__)
+#define UTILS_PRINTF_FORMAT(formatIndex, argsIndex) __attribute__((format(printf, formatIndex, argsIndex)))
+#else
+#define UTILS_PRINTF_FORMAT(formatIndex, argsIndex)
+#endif
+
+//! Форматирование в std::string. Сообщение собирается во внутреннем буфере на стеке
+//! за один проход, память в куче выделяется только под результат (и под длинные строки)
+std::string Format(const char* format, ...) UTILS_PRINTF_FORMAT(1, 2);
+
+//! Форматирование в буфер вызывающего, без выделения памяти.
+//! Результат всегда завершается нулём и обрезается по размеру буфера.
+//! @return длина записанной строки
+size_t FormatTo(char* aBuffer, size_t aSize, const char* format, ...) UTILS_PRINTF_FORMAT(3, 4);
+
+//! Пустая функция для проверки формата и аргументов при компиляции (используется в макросах логгера)
+inline void CheckFormat(const char* /*format*/, ...) UTILS_PRINTF_FORMAT(1, 2);
+inline void CheckFormat(const char* /*format*/, ...) {}
+
+//! Строка с буфером фиксированного размера внутри объекта (без выделения памяти)
+template <size_t N>
+class InlineString
 {
-    char b;
-    unsigned int required = std::snprintf(&b, 0, format, vs...) + 1;
-
-    std::unique_ptr<char[]> bytes = std::unique_ptr<char[]>(new char[required]);
-    std::snprintf(bytes.get(), required, format, vs...);
-
-    return std::string(bytes.get());
-}
+	char mData[N];
+	size_t mSize = 0;
+
+public:
+	InlineString() { mData[0] = '\0'; }
+
+	//! Собрать строку по формату, длинный результат обрезается
+	InlineString& Format(const char* format, ...) UTILS_PRINTF_FORMAT(2, 3)
+	{
+		va_list args;
+		va_start(args, format);
+		const int length = std::vsnprintf(mData, N, format, args);
+		va_end(args);
+		mSize = length < 0 ? 0 : (static_cast<size_t>(length) < N ? static_cast<size_t>(length) : N - 1);
+		mData[mSize] = '\0';
+		return *this;
+	}
+	//! Дописать строку
+	InlineString& Append(const char* aString, size_t aSize)
+	{
+		const size_t size = mSize + aSize < N ? aSize : N - 1 - mSize;
+		std::memcpy(mData + mSize, aString, size);
+		mSize += size;
+		mData[mSize] = '\0';
+		return *this;
+	}
+
+	const char* c_str() const { return mData; }
+	size_t size() const { return mSize; }
+	std::string str() const { return std::string(mData, mSize); }
+};
 
 tm TimeToTimeT(const std::chrono::system_clock::time_point& time);
 tm GetNowTm();
 std::chrono::system_clock::time_point TmToTimePoint(tm& aTm);
 
 std::string Format(const std::chrono::system_clock::time_point& time);
+//! Записать метку времени "[YYYY-MM-DD HH:MM:SS.mmm] " в буфер вызывающего.
+//! Часть до секунд кэшируется на поток и пересчитывается раз в секунду.
+//! @return длина записанной строки
+size_t FormatTimestampTo(char* aBuffer, size_t aSize, const std::chrono::system_clock::time_point& time);
 std::string FormatTimeShort(const std::chrono::system_clock::time_point& time);
 std::string FormatFileName(const std::chrono::system_clock::time_point& time);
 std::string FormatFileNameYearDayMonth(std::chrono::system_clock::time_point time);
@@ -0,0 +1,100 @@
+#ifndef PHOTO_FINISH_H_
+#define PHOTO_FINISH_H_
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+
+
+namespace Fatracing {
+
+// Итог гонки на дорожке с точностью до долей импульса
+struct LaneResult {
+    // Пройдено импульсов к финишу (с дробной частью по соседним импульсам)
+    double Distance = 0.0;
+    // То же в метрах по настройкам дорожки
+    double Meters = 0.0;
+    // Момент финиша дорожки от старта гонки, мкс (-1 - ещё не финишировала)
+    int64_t FinishTimeUs = -1;
+    // Место: 1 - первое, у равных результатов одинаковое; 0 - ещё не определено
+    int Place = 0;
+};
+
+typedef std::array<LaneResult, 2> LaneResults;
+
+// Моменты двух последних импульсов дорожки. Положение между импульсами считается линейным:
+// за интервал между соседними импульсами колесо проходит ровно один импульс.
+// Старт гонки считается нулевым импульсом.
+struct LaneTiming {
+    typedef std::chrono::steady_clock Clock;
+
+    uint64_t Count = 0;
+    Clock::time_point PrevPulse;
+    Clock::time_point LastPulse;
+
+    void Reset(Clock::time_point aStartTime) {
+        Count = 0;
+        PrevPulse = aStartTime;
+        LastPulse = aStartTime;
+    }
+
+    void AddPulse(Clock::time_point aTime) {
+        ++Count;
+        PrevPulse = LastPulse;
+        LastPulse = aTime;
+    }
+
+    // Пройдено импульсов в момент aTime, если следующий после LastPulse импульс пришёл в aNextPulse
+    double DistanceAt(Clock::time_point aTime, Clock::time_point aNextPulse) const {
+        const double span = std::chrono::duration<double>(aNextPulse - LastPulse).count();
+        const double elapsed = std::chrono::duration<double>(aTime - LastPulse).count();
+        if (span <= 0.0 || elapsed <= 0.0) {
+            return static_cast<double>(Count);
+        }
+        return Count + std::min(elapsed / span, 1.0);
+    }
+
+    // Момент, когда дорожка прошла aTarget импульсов; вызывается на импульсе, с которым Count >= aTarget
+    Clock::time_point CrossingTime(double aTarget) const {
+        const double fraction = aTarget - static_cast<double>(Count - 1);
+        return PrevPulse + std::chrono::duration_cast<Clock::duration>((LastPulse - PrevPulse) * std::max(fraction, 0.0));
+    }
+};
+
+inline int64_t ToMicroseconds(std::chrono::steady_clock::duration aDuration) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(aDuration).count();
+}
+
+// Места по финишному времени (гонка на дистанцию): раньше - выше, равные с точностью до мкс делят место.
+// Нефинишировавшие дорожки стоят ниже финишировавших и ранжируются по пройденным метрам.
+// Места по метрам (гонка на время): больше - выше; разница меньше 1 мкс хода отстающей дорожки -
+// ничья. aSecondsPerMeter - темп каждой дорожки на финише, с/м.
+inline void AssignPlaces(LaneResults& aResults, const std::array<double, 2>& aSecondsPerMeter) {
+    const auto ahead = [&](size_t a, size_t b) {
+        const LaneResult& ra = aResults[a];
+        const LaneResult& rb = aResults[b];
+        if ((ra.FinishTimeUs >= 0) != (rb.FinishTimeUs >= 0)) {
+            return ra.FinishTimeUs >= 0 ? 1 : -1;
+        }
+        if (ra.FinishTimeUs >= 0 && ra.FinishTimeUs != rb.FinishTimeUs) {
+            return ra.FinishTimeUs < rb.FinishTimeUs ? 1 : -1;
+        }
+        // разница в метрах, переведённая во время отстающей дорожки
+        const size_t behind = ra.Meters < rb.Meters ? a : b;
+        const double gapUs = std::fabs(ra.Meters - rb.Meters) * aSecondsPerMeter[behind] * 1e6;
+        if (gapUs < 1.0) {
+            return 0;
+        }
+        return ra.Meters > rb.Meters ? 1 : -1;
+    };
+    const int order = ahead(0, 1);
+    aResults[0].Place = order >= 0 ? 1 : 2;
+    aResults[1].Place = order <= 0 ? 1 : 2;
+}
+
+}
+
+#endif // PHOTO_FINISH_H_
@@ -1,21 +1,62 @@
+#include <cmath>
 #include <functional>
 
 #include "./Race.h"
+#include "Trace.h"
 
 
 namespace Fatracing {
 
-Race::Race(SettingsStruct &aSettings, Race::RaceCallback aRaceCallback) {
+const int Race::ResultTimeoutMs;
+
+Race::Race(SettingsStruct &aSettings, Race::RaceCallback aRaceCallback) :
+    mTickJitter(Metrics::Instance().AddHistogram("fatracing_race_tick_jitter_seconds",
+                                                 "Deviation of race timer ticks from one second",
+                                                 Metrics::LatencyBounds())) {
+    Metrics& metrics = Metrics::Instance();
+    mPulseMetric[static_cast<size_t>(RacersEnum::BLUE)] =
+        &metrics.AddCounter("fatracing_pulses_total", "Pulses received per lane", "lane=\"blue\"");
+    mPulseMetric[static_cast<size_t>(RacersEnum::RED)] =
+        &metrics.AddCounter("fatracing_pulses_total", "Pulses received per lane", "lane=\"red\"");
     mSettings = aSettings;
     mRaceCallback = aRaceCallback;
+    if (!mSettings.JournalDirectory.empty()) {
+        mJournal.reset(new RaceJournal(mSettings.JournalDirectory));
+    }
+    if (!mSettings.SessionDirectory.empty()) {
+        mSession.reset(new RaceSession(mSettings));
+        if (!mSession->IsActive()) {
+            mSession.reset();
+        }
+    }
+    for (size_t lane = 0; lane < mTargetPulses.size(); ++lane) {
+        const double metersPerPulse = mSettings.Lanes[lane].MetersPerPulse();
+        mMetersPerPulse[lane] = metersPerPulse;
+        mTargetPulses[lane] = mSettings.RaceDistanceMeters > 0.0 && metersPerPulse > 0.0 ?
+                              mSettings.RaceDistanceMeters / metersPerPulse : 0.0;
+    }
+    for (auto& count : mPulseCount) {
+        count = 0;
+    }
+    // без старта (свободный режим) время событий отсчитывается от создания гонки
+    mStartTime = std::chrono::steady_clock::now();
     Clear();
 }
 
 Race::~Race() {
+    // поток чтения BlackBox вызывает BlackBoxCallback: останавливается раньше остальных членов
+    mBlackBox.reset();
     mStopThread = true;
     if (mThread.joinable()) {
         mThread.join();
     }
+    std::lock_guard<std::mutex> lock(mRaceStateMutex);
+    if (mJournal) {
+        mJournal->EndRace();
+    }
+    if (mSession) {
+        mSession->EndRace();
+    }
 }
 
 void Race::Init() {
@@ -27,48 +68,272 @@ void Race::Init() {
     ss.PortName = mSettings.PortName;
     ss.PortOnly = true;
     mBlackBox->Init(ss);
-    mBlackBox->SetCallback(std::bind(&Race::BlackBoxCallback, this, std::placeholders::_1));
+    mBlackBox->SetCallback(std::bind(&Race::BlackBoxCallback, this, std::placeholders::_1, std::placeholders::_2));
 }
 
 void Race::Start() {
-    Clear();
     if (mThread.joinable()) {
         mThread.join();
     }
-    mThread = std::thread([&](){
-        int i = mSettings.RaceTimeSeconds;
-        while (i >= 0) {
-        //for (; i >= 0; --i) {
-            std::this_thread::sleep_for(std::chrono::seconds(1));
+    const int countdown = std::max(mSettings.CountdownSeconds, 0);
+    const auto goTime = std::chrono::steady_clock::now() + std::chrono::seconds(countdown);
+    if (countdown > 0) {
+        BeginCountdown(goTime, countdown);
+    } else {
+        Begin(goTime);
+    }
+
+    mThread = std::thread([this, goTime, countdown](){
+        Tracer::Instance().SetThreadName("RaceTimer");
+        // отсчёт ведётся от момента сигнала старта, ошибки сна не накапливаются
+        for (int left = countdown - 1; left >= 0; --left) {
+            std::this_thread::sleep_until(goTime - std::chrono::seconds(left));
             if (mStopThread) {
+                return;
+            }
+            if (left > 0) {
+                CountdownTick(left);
+            } else if (!Go(goTime)) {
+                // отсчёт отменён (Clear)
+                return;
+            }
+        }
+        // RaceTimeSeconds тиков: последний тик (Seconds == 0) заканчивает гонку.
+        // Тики идут по расписанию от сигнала старта, ошибки сна не накапливаются,
+        // время тика - расписание: финиш ровно через RaceTimeSeconds после старта
+        const int ticks = std::max(mSettings.RaceTimeSeconds, 1);
+        for (int tick = 1; tick <= ticks; ++tick) {
+            const auto tickTime = goTime + std::chrono::seconds(tick);
+            std::this_thread::sleep_until(tickTime);
+            // гонка на дистанцию заканчивается импульсом последней финишировавшей дорожки
+            if (mStopThread || GetSnapshot()->Finish) {
                 break;
             }
-            TimerTick();
-            i--;
+            mTickJitter.Observe(std::chrono::steady_clock::now() - tickTime);
+            TimerTick(tickTime);
+        }
+        // импульсы после финиша не пришли: результаты по верхней границе интервала
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(ResultTimeoutMs);
+        while (!mStopThread && std::chrono::steady_clock::now() < deadline && !GetSnapshot()->ResultsFinal) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        if (!mStopThread && !GetSnapshot()->ResultsFinal) {
+            TimerTick(std::chrono::steady_clock::now());
         }
     });
 }
 
+void Race::StartManual(std::chrono::steady_clock::time_point aStartTime) {
+    BeginCountdown(aStartTime, 0);
+}
+
+void Race::Tick(std::chrono::steady_clock::time_point aTime) {
+    TimerTick(aTime);
+}
+
+void Race::Begin(std::chrono::steady_clock::time_point aStartTime) {
+    // сброс и начало журнала под одной блокировкой: каждый импульс новой гонки попадает в журнал
+    std::unique_lock<std::mutex> lock(mRaceStateMutex);
+    BeginLocked(aStartTime);
+    auto snapshot = MakeSnapshot(mCurrentRaceState);
+    lock.unlock();
+
+    Publish(snapshot);
+}
+
+void Race::BeginLocked(std::chrono::steady_clock::time_point aStartTime) {
+    const auto starts = mCountdown ? mCurrentRaceState.Starts : std::array<LaneStart, 2>();
+    if (mJournal) {
+        mJournal->EndRace();
+        mJournal->BeginRace(mSettings, aStartTime);
+        for (size_t lane = 0; lane < starts.size(); ++lane) {
+            if (starts[lane].FalseStart) {
+                mJournal->AddFalseStart(static_cast<RacersEnum>(lane), mFalseStartTime[lane]);
+            }
+        }
+    }
+    if (mSession) {
+        mSession->BeginRace(mSettings, aStartTime);
+        for (size_t lane = 0; lane < starts.size(); ++lane) {
+            if (starts[lane].FalseStart) {
+                mSession->Add(RaceJournal::MakeFalseStart(static_cast<RacersEnum>(lane), mFalseStartTime[lane]));
+            }
+        }
+    }
+    ResetState();
+    mCurrentRaceState.Starts = starts;
+    mStartTime = aStartTime;
+    mRunning = true;
+    for (size_t lane = 0; lane < mLaneTiming.size(); ++lane) {
+        mLaneTiming[lane].Reset(aStartTime);
+        mLaneStats[lane].Reset(aStartTime, mSettings.Lanes[lane].MetersPerPulse(), mSettings.Lanes[lane].Gearing,
+                               mSettings.SplitMeters);
+    }
+}
+
+void Race::BeginCountdown(std::chrono::steady_clock::time_point aGoTime, int aSeconds) {
+    std::unique_lock<std::mutex> lock(mRaceStateMutex);
+    ResetState();
+    mCountdown = true;
+    mGoTime = aGoTime;
+    mCurrentRaceState.Countdown = aSeconds;
+    mCurrentRaceState.EventTimeUs = -static_cast<int64_t>(aSeconds) * 1000000;
+    auto snapshot = MakeSnapshot(mCurrentRaceState);
+    lock.unlock();
+
+    Publish(snapshot);
+}
+
+void Race::CountdownTick(int aSecondsLeft) {
+    std::unique_lock<std::mutex> lock(mRaceStateMutex);
+    if (!mCountdown) {
+        return;
+    }
+    mCurrentRaceState.Countdown = aSecondsLeft;
+    // поток таймера будит отсчёт ровно за aSecondsLeft секунд до сигнала старта
+    mCurrentRaceState.EventTimeUs = -static_cast<int64_t>(aSecondsLeft) * 1000000;
+    auto snapshot = MakeSnapshot(mCurrentRaceState);
+    lock.unlock();
+
+    Publish(snapshot);
+}
+
+bool Race::Go(std::chrono::steady_clock::time_point aGoTime) {
+    std::unique_lock<std::mutex> lock(mRaceStateMutex);
+    if (!mCountdown) {
+        // гонку уже начал импульс после сигнала старта или отсчёт отменён
+        return mGoTime == aGoTime && mStartTime == aGoTime;
+    }
+    BeginLocked(aGoTime);
+    auto snapshot = MakeSnapshot(mCurrentRaceState);
+    lock.unlock();
+
+    Publish(snapshot);
+    return true;
+}
+
+void Race::GoIfDue(std::chrono::steady_clock::time_point aTime) {
+    if (mCountdown && aTime >= mGoTime) {
+        BeginLocked(mGoTime);
+    }
+}
+
 void Race::Clear() {
     std::unique_lock<std::mutex> lock(mRaceStateMutex);
+    ResetState();
+    auto snapshot = MakeSnapshot(mCurrentRaceState);
+    lock.unlock();
+
+    Publish(snapshot);
+}
+
+void Race::ResetState() {
     mCurrentRaceState.Seconds = mSettings.RaceTimeSeconds;
     mCurrentRaceState.BlueScore = 0;
     mCurrentRaceState.RedScore = 0;
     mCurrentRaceState.BlueRPM = 0;
     mCurrentRaceState.RedRPM = 0;
+    mCurrentRaceState.PrevBlueScore = 0;
+    mCurrentRaceState.PrevRedScore = 0;
+    mCurrentRaceState.Leader = RacersEnum::RED;
+    mCurrentRaceState.Diff = 0.0;
     mCurrentRaceState.Finish = false;
+    mCurrentRaceState.Results = LaneResults();
+    mCurrentRaceState.ResultsFinal = false;
+    mCurrentRaceState.Stats = RaceLaneStats();
+    mCurrentRaceState.Countdown = 0;
+    mCurrentRaceState.Starts = std::array<LaneStart, 2>();
+    mCountdown = false;
+    mRunning = false;
+    mResultPending.fill(false);
+    mLaneFinished.fill(false);
+    mFinishGap = 0.0;
+    mCurrentRaceState.PulseTime = std::chrono::steady_clock::time_point();
+    mCurrentRaceState.EventTimeUs = 0;
+}
+
+uint64_t Race::GetPulseCount(RacersEnum aRacer) const {
+    return mPulseCount[static_cast<size_t>(aRacer)];
+}
+
+RaceSnapshot Race::GetSnapshot() const {
+    return std::atomic_load(&mSnapshot);
+}
 
+RaceSnapshot Race::MakeSnapshot(RaceStruct aRaceStruct) {
+    auto snapshot = std::make_shared<const RaceStruct>(std::move(aRaceStruct));
+    std::atomic_store(&mSnapshot, snapshot);
+    return snapshot;
+}
+
+void Race::Publish(const RaceSnapshot& aSnapshot) {
     if (mRaceCallback) {
-        mRaceCallback(mCurrentRaceState);
+        mRaceCallback(aSnapshot);
     }
 }
 
 
-void Race::TimerTick() {
+void Race::TimerTick(std::chrono::steady_clock::time_point aTime) {
+    TRACE_SCOPE("Race", "TimerTick");
     std::unique_lock<std::mutex> lock(mRaceStateMutex);
+    GoIfDue(aTime);
+    if (mCountdown) {
+        return;
+    }
+    if (mCurrentRaceState.ResultsFinal) {
+        // гонка уже закончилась импульсом (гонка на дистанцию) раньше этого тика
+        return;
+    }
+    if (mCurrentRaceState.Finish ? aTime <= mFinishTime : aTime < NextTickTime()) {
+        // этот тик уже отсчитан импульсом, пришедшим позже него (CatchUpTicks)
+        return;
+    }
+    if (mCurrentRaceState.Finish) {
+        // тик после финиша: импульсы после финиша не пришли за ResultTimeoutMs,
+        // дистанция считается по верхней границе - следующий импульс не раньше этого тика
+        if (mJournal) {
+            mJournal->AddTick(aTime, mCurrentRaceState.Seconds, true);
+        }
+        if (mSession) {
+            mSession->Add(RaceJournal::MakeTick(aTime, mCurrentRaceState.Seconds, true));
+        }
+        for (size_t lane = 0; lane < mResultPending.size(); ++lane) {
+            if (mResultPending[lane]) {
+                ResolveResult(lane, aTime);
+            }
+        }
+        FinalizeResults();
+    } else {
+        CountSecond(aTime);
+    }
+
+    RaceStruct r = mCurrentRaceState;
+    r.PulseTime = std::chrono::steady_clock::time_point();
+    r.EventTimeUs = ToMicroseconds(aTime - mStartTime);
+    auto snapshot = MakeSnapshot(std::move(r));
+    lock.unlock();
+
+    Publish(snapshot);
+}
+
+std::chrono::steady_clock::time_point Race::NextTickTime() const {
+    return mStartTime + std::chrono::seconds(mSettings.RaceTimeSeconds - mCurrentRaceState.Seconds + 1);
+}
+
+void Race::CatchUpTicks(std::chrono::steady_clock::time_point aTime) {
+    // поток таймера ещё не отсчитал прошедшие секунды: импульс после финиша должен
+    // замкнуть интервал фотофиниша, а не попасть в счёт
+    while (mRunning && !mCurrentRaceState.Finish && aTime >= NextTickTime()) {
+        CountSecond(NextTickTime());
+    }
+}
+
+void Race::CountSecond(std::chrono::steady_clock::time_point aTime) {
     if (mCurrentRaceState.Seconds > 0) {
         mCurrentRaceState.Seconds--;
-    } else {
+    }
+    // финиш ровно через RaceTimeSeconds после старта, а не секундой позже
+    if (mCurrentRaceState.Seconds == 0) {
         mCurrentRaceState.Finish = true;
     }
 
@@ -78,17 +343,47 @@ void Race::TimerTick() {
     mCurrentRaceState.PrevBlueScore = mCurrentRaceState.BlueScore;
     mCurrentRaceState.PrevRedScore = mCurrentRaceState.RedScore;
 
-    RaceStruct r = mCurrentRaceState;
-    lock.unlock();
-
-    if (mRaceCallback) {
-        mRaceCallback(r);
+    if (mJournal) {
+        mJournal->AddTick(aTime, mCurrentRaceState.Seconds, mCurrentRaceState.Finish);
+    }
+    if (mSession) {
+        // блок данных сессии уходит на запись раз в секунду гонки
+        mSession->Add(RaceJournal::MakeTick(aTime, mCurrentRaceState.Seconds, mCurrentRaceState.Finish));
+        mSession->Flush();
+    }
+    if (mCurrentRaceState.Finish) {
+        OnFinish(aTime);
     }
 }
 
-void Race::BlackBoxCallback(RacersEnum aRacer) {
+void Race::BlackBoxCallback(RacersEnum aRacer, std::chrono::steady_clock::time_point aPulseTime) {
+    TRACE_SCOPE("Race", "BlackBoxCallback");
+    mPulseCount[static_cast<size_t>(aRacer)].fetch_add(1, std::memory_order_relaxed);
+    mPulseMetric[static_cast<size_t>(aRacer)]->Increment();
     std::unique_lock<std::mutex> lock(mRaceStateMutex);
 
+    const size_t lane = static_cast<size_t>(aRacer);
+    // импульс после сигнала старта начинает гонку, даже если поток таймера ещё не проснулся
+    GoIfDue(aPulseTime);
+    CatchUpTicks(aPulseTime);
+    if (mCountdown) {
+        // до сигнала старта импульсы в счёт не идут; в пределах порога - фальстарт
+        LaneStart& start = mCurrentRaceState.Starts[lane];
+        if (start.FalseStart || aPulseTime < mGoTime - std::chrono::milliseconds(mSettings.FalseStartThresholdMs)) {
+            return;
+        }
+        start.FalseStart = true;
+        mFalseStartTime[lane] = aPulseTime;
+        LOGGER_LOG(PriorityEnum::Warning, "Фальстарт дорожки %d за %.3f мс до старта", static_cast<int>(lane),
+                   std::chrono::duration<double, std::milli>(mGoTime - aPulseTime).count());
+        mCurrentRaceState.PulseTime = aPulseTime;
+        mCurrentRaceState.EventTimeUs = ToMicroseconds(aPulseTime - mGoTime);
+        auto snapshot = MakeSnapshot(mCurrentRaceState);
+        lock.unlock();
+
+        Publish(snapshot);
+        return;
+    }
     if (!mCurrentRaceState.Finish) {
         switch (aRacer) {
             case RacersEnum::BLUE: {
@@ -100,20 +395,131 @@ void Race::BlackBoxCallback(RacersEnum aRacer) {
                 break;
             }
         }
+        mLaneTiming[lane].AddPulse(aPulseTime);
+        LaneStart& start = mCurrentRaceState.Starts[lane];
+        if (start.ReactionUs < 0 && aPulseTime >= mStartTime) {
+            start.ReactionUs = ToMicroseconds(aPulseTime - mStartTime);
+        }
+        if (!mLaneFinished[lane]) {
+            mLaneStats[lane].AddPulse(mLaneTiming[lane]);
+        }
+    }
+    const uint64_t score = aRacer == RacersEnum::BLUE ? mCurrentRaceState.BlueScore : mCurrentRaceState.RedScore;
+    if (mJournal) {
+        mJournal->AddPulse(aRacer, aPulseTime, score);
+    }
+    if (mSession) {
+        mSession->Add(RaceJournal::MakePulse(aRacer, aPulseTime, score));
+    }
+    if (!mCurrentRaceState.Finish && !mLaneFinished[lane] && mTargetPulses[lane] > 0.0) {
+        CheckLaneFinish(lane, aPulseTime);
     }
 
-    if (mCurrentRaceState.BlueScore > mCurrentRaceState.RedScore) {
-        mCurrentRaceState.Leader = RacersEnum::BLUE;
-        mCurrentRaceState.Diff = mCurrentRaceState.BlueScore - mCurrentRaceState.RedScore;
+    if (mCurrentRaceState.Finish) {
+        // первый импульс после финиша замыкает интервал, в котором дорожка пересекла момент финиша
+        if (mResultPending[lane] && aPulseTime > mFinishTime) {
+            ResolveResult(lane, aPulseTime);
+            FinalizeResults();
+        }
     } else {
-        mCurrentRaceState.Leader = RacersEnum::RED;
-        mCurrentRaceState.Diff = mCurrentRaceState.RedScore - mCurrentRaceState.BlueScore;
+        // у дорожек может быть разная передача: лидер и отрыв - в метрах, не в импульсах
+        const double blueMeters = mCurrentRaceState.BlueScore * mMetersPerPulse[static_cast<size_t>(RacersEnum::BLUE)];
+        const double redMeters = mCurrentRaceState.RedScore * mMetersPerPulse[static_cast<size_t>(RacersEnum::RED)];
+        mCurrentRaceState.Leader = blueMeters > redMeters ? RacersEnum::BLUE : RacersEnum::RED;
+        mCurrentRaceState.Diff = std::fabs(blueMeters - redMeters);
     }
-    RaceStruct r = mCurrentRaceState;
+    mCurrentRaceState.PulseTime = aPulseTime;
+    mCurrentRaceState.EventTimeUs = ToMicroseconds(aPulseTime - mStartTime);
+    auto snapshot = MakeSnapshot(mCurrentRaceState);
     lock.unlock();
 
-    if (mRaceCallback) {
-        mRaceCallback(r);
+    Publish(snapshot);
+}
+
+void Race::OnFinish(std::chrono::steady_clock::time_point aTime) {
+    mFinishTime = aTime;
+    const bool distanceRace = mSettings.RaceDistanceMeters > 0.0;
+    for (size_t lane = 0; lane < mLaneTiming.size(); ++lane) {
+        if (mLaneFinished[lane]) {
+            continue;
+        }
+        // в гонке на дистанцию дорожка не успела к ограничению по времени: время финиша не задаётся
+        LaneResult& result = mCurrentRaceState.Results[lane];
+        result.Distance = static_cast<double>(mLaneTiming[lane].Count);
+        result.FinishTimeUs = distanceRace ? -1 : ToMicroseconds(aTime - mStartTime);
+        mResultPending[lane] = true;
+    }
+}
+
+void Race::CheckLaneFinish(size_t aLane, std::chrono::steady_clock::time_point aPulseTime) {
+    const LaneTiming& timing = mLaneTiming[aLane];
+    if (static_cast<double>(timing.Count) < mTargetPulses[aLane]) {
+        return;
+    }
+    if (!mLaneFinished[0] && !mLaneFinished[1]) {
+        // после финиша обоих дистанции равны цели: отрыв запоминается, пока вторая дорожка в пути
+        const double otherMeters = mLaneTiming[1 - aLane].Count * mMetersPerPulse[1 - aLane];
+        mFinishGap = std::max(mSettings.RaceDistanceMeters - otherMeters, 0.0);
+    }
+    LaneResult& result = mCurrentRaceState.Results[aLane];
+    result.Distance = mTargetPulses[aLane];
+    result.FinishTimeUs = ToMicroseconds(timing.CrossingTime(mTargetPulses[aLane]) - mStartTime);
+    mLaneFinished[aLane] = true;
+    LOGGER_LOG(PriorityEnum::Info, "Дорожка %d финишировала: %.6f с", static_cast<int>(aLane), result.FinishTimeUs / 1e6);
+
+    for (bool finished : mLaneFinished) {
+        if (!finished) {
+            return;
+        }
+    }
+    mCurrentRaceState.Finish = true;
+    mFinishTime = aPulseTime;
+    FinalizeResults();
+}
+
+void Race::ResolveResult(size_t aLane, std::chrono::steady_clock::time_point aNextPulse) {
+    mCurrentRaceState.Results[aLane].Distance = mLaneTiming[aLane].DistanceAt(mFinishTime, aNextPulse);
+    mResultPending[aLane] = false;
+}
+
+void Race::FinalizeResults() {
+    for (bool pending : mResultPending) {
+        if (pending) {
+            return;
+        }
+    }
+    LaneResults& results = mCurrentRaceState.Results;
+    std::array<double, 2> secondsPerMeter;
+    for (size_t lane = 0; lane < mLaneTiming.size(); ++lane) {
+        const double metersPerPulse = mSettings.Lanes[lane].MetersPerPulse();
+        const double pulseSeconds = std::chrono::duration<double>(mLaneTiming[lane].LastPulse - mLaneTiming[lane].PrevPulse).count();
+        results[lane].Meters = results[lane].Distance * metersPerPulse;
+        secondsPerMeter[lane] = metersPerPulse > 0.0 ? pulseSeconds / metersPerPulse : 0.0;
+        // нефинишировавшая дорожка ехала до конца гонки
+        const int64_t elapsedUs = results[lane].FinishTimeUs >= 0 ?
+                                  results[lane].FinishTimeUs : ToMicroseconds(mFinishTime - mStartTime);
+        mCurrentRaceState.Stats[lane] = mLaneStats[lane].Finish(results[lane].Meters, elapsedUs);
+    }
+    AssignPlaces(results, secondsPerMeter);
+    mCurrentRaceState.ResultsFinal = true;
+
+    // лидер по результату фотофиниша, отрыв - в метрах
+    const size_t blue = static_cast<size_t>(RacersEnum::BLUE);
+    const size_t red = static_cast<size_t>(RacersEnum::RED);
+    mCurrentRaceState.Leader = results[blue].Place < results[red].Place ? RacersEnum::BLUE : RacersEnum::RED;
+    if (mLaneFinished[blue] && mLaneFinished[red]) {
+        mCurrentRaceState.Diff = mFinishGap;
+    } else {
+        mCurrentRaceState.Diff = std::fabs(results[blue].Meters - results[red].Meters);
+    }
+
+    LOGGER_LOG(PriorityEnum::Info, "Финиш: синий %.4f м (место %d), красный %.4f м (место %d)",
+               results[blue].Meters, results[blue].Place, results[red].Meters, results[red].Place);
+    if (mJournal) {
+        mJournal->EndRace();
+    }
+    if (mSession) {
+        mSession->EndRace();
     }
 }
 
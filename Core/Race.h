@@ -1,21 +1,39 @@
 #ifndef RACE_H_
 #define RACE_H_
 
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <memory>
 #include <functional>
 #include <mutex>
 
 #include "Logger.h"
+#include "Metrics.h"
 
 #include "../BlackBox/BlackBox.h"
+#include "./PhotoFinish.h"
+#include "./RaceJournal.h"
+#include "./RaceSession.h"
+#include "./RaceStats.h"
 #include "./Settings.h"
 #include "./Defines.h"
 
 
 namespace Fatracing {
 
+// Старт дорожки
+struct LaneStart {
+    // Импульс в пределах порога до сигнала старта
+    bool FalseStart = false;
+    // От сигнала старта до первого импульса, мкс (-1 - импульса ещё не было)
+    int64_t ReactionUs = -1;
+};
+
 struct RaceStruct {
     int Seconds;
+    // Секунд до сигнала старта (0 - отсчёта нет или гонка уже идёт)
+    int Countdown = 0;
 
     uint64_t BlueScore = 0;
     uint64_t RedScore = 0;
@@ -26,15 +44,35 @@ struct RaceStruct {
     bool Finish=false;
 
     RacersEnum Leader;
-    uint64_t Diff;
+    // Отрыв лидера, м (у дорожек может быть разная передача)
+    double Diff;
 
     uint64_t PrevBlueScore = 0;
     uint64_t PrevRedScore = 0;
+
+    // Время прихода импульса, породившего это состояние (нулевое для тиков таймера)
+    std::chrono::steady_clock::time_point PulseTime;
+    // Время события (импульса, тика, сигнала отсчёта), от которого получено это состояние,
+    // относительно сигнала старта, мкс; до старта отрицательное
+    int64_t EventTimeUs = 0;
+
+    // Результаты по дорожкам (индекс - RacersEnum) с точностью до долей импульса
+    LaneResults Results;
+    // Results окончательные: для каждой дорожки известны импульсы по обе стороны финиша
+    bool ResultsFinal = false;
+    // Статистика дорожек, заполняется вместе с окончательными результатами
+    RaceLaneStats Stats;
+
+    std::array<LaneStart, 2> Starts;
 };
 
+// Неизменяемый снимок состояния гонки. Создаётся один раз на событие и разделяется
+// между всеми читателями без копирования
+typedef std::shared_ptr<const RaceStruct> RaceSnapshot;
+
 class Race {
 public:
-    typedef std::function<void(RaceStruct)> RaceCallback;
+    typedef std::function<void(const RaceSnapshot&)> RaceCallback;
 
 private:
     std::shared_ptr<BlackBox> mBlackBox = nullptr;
@@ -43,10 +81,51 @@ private:
 
     std::mutex mRaceStateMutex;
     RaceStruct mCurrentRaceState;
+    // Последний опубликованный снимок, читается через std::atomic_load
+    RaceSnapshot mSnapshot;
 
     std::thread mThread;
     std::atomic<bool> mStopThread{false};
 
+    // Сколько после финиша ждать следующих импульсов для интерполяции, мс
+    static const int ResultTimeoutMs = 1000;
+
+    // Идёт обратный отсчёт до сигнала старта в mGoTime; под mRaceStateMutex
+    bool mCountdown = false;
+    std::chrono::steady_clock::time_point mGoTime;
+    // Гонка начата (сигнал старта был) и ещё не сброшена; под mRaceStateMutex
+    bool mRunning = false;
+    // Первые импульсы фальстарта по дорожкам, пишутся в журнал вместе с началом гонки
+    std::array<std::chrono::steady_clock::time_point, 2> mFalseStartTime;
+
+    // Старт и финиш текущей гонки, последние импульсы дорожек; под mRaceStateMutex
+    std::chrono::steady_clock::time_point mStartTime;
+    std::chrono::steady_clock::time_point mFinishTime;
+    std::array<LaneTiming, 2> mLaneTiming;
+    // Дорожки, для которых ещё не пришёл импульс после финиша
+    std::array<bool, 2> mResultPending;
+    // Гонка на дистанцию: цель в импульсах по дорожкам (0 - гонка на время) и финишировавшие дорожки
+    std::array<double, 2> mTargetPulses;
+    // Метров на импульс по дорожкам (из настроек)
+    std::array<double, 2> mMetersPerPulse;
+    std::array<bool, 2> mLaneFinished;
+    // Отрыв в метрах в момент финиша первой дорожки (итоговый отрыв гонки на дистанцию)
+    double mFinishGap = 0.0;
+    // Статистика дорожек, копится по импульсам до финиша дорожки
+    std::array<LaneStatsAccumulator, 2> mLaneStats;
+
+    // Журнал гонок, если в настройках задан каталог
+    std::unique_ptr<RaceJournal> mJournal;
+    // Запись сессии на диск, если в настройках задан каталог
+    std::unique_ptr<RaceSession> mSession;
+
+    // Все импульсы по дорожкам с момента создания, включая пришедшие вне гонки
+    std::array<std::atomic<uint64_t>, 2> mPulseCount;
+
+    // Метрики: импульсы по дорожкам и отклонение тиков таймера от секунды
+    std::array<MetricCounter*, 2> mPulseMetric;
+    MetricHistogram& mTickJitter;
+
 public:
     Race(SettingsStruct& aSettings, RaceCallback aRaceCallback);
     ~Race();
@@ -55,9 +134,53 @@ public:
     void Start();
     void Clear();
 
+    // Старт без собственного таймера (воспроизведение): время старта и тики задаёт вызывающий.
+    // До aStartTime идёт обратный отсчёт, гонка начинается первым импульсом или тиком не раньше aStartTime
+    void StartManual(std::chrono::steady_clock::time_point aStartTime);
+    // Тик таймера гонки в момент aTime (для StartManual)
+    void Tick(std::chrono::steady_clock::time_point aTime);
+
+    // Последний опубликованный снимок состояния (можно вызывать из любого потока)
+    RaceSnapshot GetSnapshot() const;
+
+    // Сколько импульсов дорожки пришло с момента создания (включая пришедшие вне гонки)
+    uint64_t GetPulseCount(RacersEnum aRacer) const;
+
+    // Импульс гонщика. Вызывается из BlackBox, открыт для прямой подачи импульсов (замеры, имитация)
+    void BlackBoxCallback(RacersEnum aRacer, std::chrono::steady_clock::time_point aPulseTime);
+
 private:
-    void TimerTick();
-    void BlackBoxCallback(RacersEnum aRacer);
+    // Вызывается под mRaceStateMutex, чтобы снимки публиковались в порядке изменений
+    RaceSnapshot MakeSnapshot(RaceStruct aRaceStruct);
+    void Publish(const RaceSnapshot& aSnapshot);
+    // Сброс состояния к началу гонки, вызывается под mRaceStateMutex
+    void ResetState();
+    // Сброс гонки и начало журнала
+    void Begin(std::chrono::steady_clock::time_point aStartTime);
+    // То же под mRaceStateMutex; фальстарты обратного отсчёта сохраняются
+    void BeginLocked(std::chrono::steady_clock::time_point aStartTime);
+    // Начать обратный отсчёт до сигнала старта в aGoTime
+    void BeginCountdown(std::chrono::steady_clock::time_point aGoTime, int aSeconds);
+    void CountdownTick(int aSecondsLeft);
+    // Сигнал старта: начать гонку, если её ещё не начал импульс после aGoTime; false - отсчёт отменён
+    bool Go(std::chrono::steady_clock::time_point aGoTime);
+    // Начать гонку, если отсчёт закончился к моменту aTime; под mRaceStateMutex
+    void GoIfDue(std::chrono::steady_clock::time_point aTime);
+    void TimerTick(std::chrono::steady_clock::time_point aTime);
+    // Секунда гонки в момент aTime (тик таймера); под mRaceStateMutex
+    void CountSecond(std::chrono::steady_clock::time_point aTime);
+    // Момент следующего тика по расписанию от старта; под mRaceStateMutex
+    std::chrono::steady_clock::time_point NextTickTime() const;
+    // Отсчитать тики, которые по расписанию наступили к aTime, а поток таймера ещё не отсчитал; под mRaceStateMutex
+    void CatchUpTicks(std::chrono::steady_clock::time_point aTime);
+    // Финиш гонки: зафиксировать дистанции, дальше ждать импульсов после финиша; под mRaceStateMutex
+    void OnFinish(std::chrono::steady_clock::time_point aTime);
+    // Гонка на дистанцию: дорожка прошла цель этим импульсом? O(1); под mRaceStateMutex
+    void CheckLaneFinish(size_t aLane, std::chrono::steady_clock::time_point aPulseTime);
+    // Дистанция дорожки на финише по импульсу после финиша в aNextPulse; под mRaceStateMutex
+    void ResolveResult(size_t aLane, std::chrono::steady_clock::time_point aNextPulse);
+    // Все дорожки известны: расставить места и закончить журнал; под mRaceStateMutex
+    void FinalizeResults();
 };
 
 }
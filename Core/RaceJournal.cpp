@@ -0,0 +1,270 @@
+#include "./RaceJournal.h"
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+#include <boost/filesystem.hpp>
+
+#include "Trace.h"
+#include "Utils.h"
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+
+namespace Fatracing {
+
+namespace {
+const char JournalMagic[8] = {'F', 'R', 'J', 'R', 'N', 'L', '1', '\0'};
+// Место в очереди, оставляемое под служебные записи, чтобы начало и конец гонки не терялись
+const size_t MarkerReserve = 16;
+
+int64_t ToNs(std::chrono::steady_clock::time_point aTime) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(aTime.time_since_epoch()).count();
+}
+}
+
+constexpr const char* RaceJournal::FileExtension;
+const uint32_t RaceJournal::Version;
+const int RaceJournal::FlushIntervalMs;
+
+RaceJournal::RaceJournal(const std::string& aDirectory) :
+    mDirectory(Utils::CheckPathCopy(aDirectory)),
+    mFileBuffer(FileBufferSize),
+    mRecordsMetric(Metrics::Instance().AddCounter("fatracing_journal_records_total",
+                                                  "Records written to race journals")),
+    mDroppedMetric(Metrics::Instance().AddCounter("fatracing_journal_dropped_total",
+                                                  "Race journal records dropped because the queue was full")) {
+    StartThread();
+}
+
+RaceJournal::~RaceJournal() {
+    StopThread();
+    Drain();
+    CloseFile();
+}
+
+JournalHeader RaceJournal::MakeHeader(const SettingsStruct& aSettings, std::chrono::steady_clock::time_point aStartTime) {
+    JournalHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.Magic, JournalMagic, sizeof(header.Magic));
+    header.Version = Version;
+    header.HeaderSize = sizeof(JournalHeader);
+    header.RecordSize = sizeof(JournalRecord);
+    header.LaneCount = 2;
+    header.RaceTimeSeconds = aSettings.RaceTimeSeconds;
+    header.FalseStartThresholdMs = static_cast<uint32_t>(std::max(aSettings.FalseStartThresholdMs, 0));
+    header.StartSteadyNs = ToNs(aStartTime);
+    header.StartSystemUs = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    std::strncpy(header.PortName, aSettings.PortName.c_str(), sizeof(header.PortName) - 1);
+    header.RaceDistanceMeters = aSettings.RaceDistanceMeters;
+    for (size_t lane = 0; lane < aSettings.Lanes.size(); ++lane) {
+        header.MetersPerPulse[lane] = aSettings.Lanes[lane].MetersPerPulse();
+    }
+    return header;
+}
+
+JournalRecord RaceJournal::MakeStart(std::chrono::steady_clock::time_point aTime, int aRaceTimeSeconds) {
+    JournalRecord record = {};
+    record.TimeNs = ToNs(aTime);
+    record.Type = JournalRecordType::Start;
+    record.Value = static_cast<uint32_t>(aRaceTimeSeconds);
+    return record;
+}
+
+JournalRecord RaceJournal::MakePulse(RacersEnum aRacer, std::chrono::steady_clock::time_point aTime, uint64_t aScore) {
+    JournalRecord record = {};
+    record.TimeNs = ToNs(aTime);
+    record.Type = JournalRecordType::Pulse;
+    record.Lane = static_cast<uint8_t>(aRacer);
+    record.Value = static_cast<uint32_t>(aScore);
+    return record;
+}
+
+JournalRecord RaceJournal::MakeTick(std::chrono::steady_clock::time_point aTime, int aSeconds, bool aFinish) {
+    JournalRecord record = {};
+    record.TimeNs = ToNs(aTime);
+    record.Type = JournalRecordType::Tick;
+    record.Lane = aFinish ? 1 : 0;
+    record.Value = static_cast<uint32_t>(aSeconds);
+    return record;
+}
+
+JournalRecord RaceJournal::MakeFalseStart(RacersEnum aRacer, std::chrono::steady_clock::time_point aTime) {
+    JournalRecord record = {};
+    record.TimeNs = ToNs(aTime);
+    record.Type = JournalRecordType::FalseStart;
+    record.Lane = static_cast<uint8_t>(aRacer);
+    return record;
+}
+
+void RaceJournal::BeginRace(const SettingsStruct& aSettings, std::chrono::steady_clock::time_point aStartTime) {
+    const JournalHeader header = MakeHeader(aSettings, aStartTime);
+    {
+        std::lock_guard<std::mutex> lock(mHeadersMutex);
+        mHeaders.push_back(header);
+    }
+
+    JournalRecord marker = {};
+    marker.Type = static_cast<JournalRecordType>(BeginMarker);
+    if (!mQueue.TryPush(marker)) {
+        std::lock_guard<std::mutex> lock(mHeadersMutex);
+        mHeaders.pop_back();
+        LOGGER_LOG(PriorityEnum::Error, "Очередь журнала гонки переполнена, гонка не записывается");
+        return;
+    }
+
+    mQueue.TryPush(MakeStart(aStartTime, aSettings.RaceTimeSeconds));
+    mActive = true;
+}
+
+void RaceJournal::EndRace() {
+    if (!mActive.exchange(false)) {
+        return;
+    }
+    JournalRecord marker = {};
+    marker.Type = static_cast<JournalRecordType>(EndMarker);
+    mQueue.TryPush(marker);
+}
+
+void RaceJournal::AddPulse(RacersEnum aRacer, std::chrono::steady_clock::time_point aTime, uint64_t aScore) {
+    Push(MakePulse(aRacer, aTime, aScore));
+}
+
+void RaceJournal::AddTick(std::chrono::steady_clock::time_point aTime, int aSeconds, bool aFinish) {
+    Push(MakeTick(aTime, aSeconds, aFinish));
+}
+
+void RaceJournal::AddFalseStart(RacersEnum aRacer, std::chrono::steady_clock::time_point aTime) {
+    Push(MakeFalseStart(aRacer, aTime));
+}
+
+void RaceJournal::Push(const JournalRecord& aRecord) {
+    if (!mActive) {
+        return;
+    }
+    if (mQueue.Size() + MarkerReserve >= mQueue.Capacity() || !mQueue.TryPush(aRecord)) {
+        ++mDropped;
+        mDroppedMetric.Increment();
+    }
+}
+
+void RaceJournal::ThreadFunc() {
+    Tracer::Instance().SetThreadName("RaceJournal");
+    auto lastFlush = std::chrono::steady_clock::now();
+    while (IsThreadActive()) {
+        const size_t count = Drain();
+        const auto now = std::chrono::steady_clock::now();
+        if (mFile && now - lastFlush >= std::chrono::milliseconds(FlushIntervalMs)) {
+            std::fflush(mFile);
+            lastFlush = now;
+        }
+        if (count == 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+    }
+}
+
+size_t RaceJournal::Drain() {
+    TRACE_SCOPE("RaceJournal", "Drain");
+    size_t count = 0;
+    JournalRecord record;
+    while (mQueue.TryPop(record)) {
+        ++count;
+        const uint8_t type = static_cast<uint8_t>(record.Type);
+        if (type == BeginMarker) {
+            CloseFile();
+            OpenFile();
+        } else if (type == EndMarker) {
+            CloseFile();
+        } else if (mFile) {
+            std::fwrite(&record, sizeof(record), 1, mFile);
+            mRecordsMetric.Increment();
+        }
+    }
+    return count;
+}
+
+void RaceJournal::OpenFile() {
+    JournalHeader header;
+    {
+        std::lock_guard<std::mutex> lock(mHeadersMutex);
+        if (mHeaders.empty()) {
+            return;
+        }
+        header = mHeaders.front();
+        mHeaders.pop_front();
+    }
+
+    boost::system::error_code err;
+    if (!mDirectory.empty()) {
+        boost::filesystem::create_directories(mDirectory, err);
+    }
+    mFilePath = mDirectory + "race_" + Utils::FormatFileName(std::chrono::system_clock::now()) + FileExtension;
+    mFile = std::fopen(mFilePath.c_str(), "wb");
+    if (!mFile) {
+        LOGGER_LOG(PriorityEnum::Error, "Не удалось создать журнал гонки \"%s\"", mFilePath.c_str());
+        return;
+    }
+    std::setvbuf(mFile, mFileBuffer.data(), _IOFBF, mFileBuffer.size());
+    std::fwrite(&header, sizeof(header), 1, mFile);
+    std::fflush(mFile);
+    mDroppedAtBegin = mDropped;
+    LOGGER_LOG(PriorityEnum::Info, "Журнал гонки: \"%s\"", mFilePath.c_str());
+}
+
+void RaceJournal::CloseFile() {
+    if (!mFile) {
+        return;
+    }
+    std::fflush(mFile);
+#ifndef _WIN32
+    fdatasync(fileno(mFile));
+#endif
+    if (std::ferror(mFile)) {
+        LOGGER_LOG(PriorityEnum::Error, "Ошибка записи журнала гонки \"%s\"", mFilePath.c_str());
+    }
+    std::fclose(mFile);
+    mFile = nullptr;
+    const uint64_t dropped = mDropped - mDroppedAtBegin;
+    if (dropped > 0) {
+        LOGGER_LOG(PriorityEnum::Warning, "В журнал гонки \"%s\" не попало записей: %llu",
+                   mFilePath.c_str(), static_cast<unsigned long long>(dropped));
+    }
+}
+
+bool RaceJournal::ReadFile(const std::string& aFilePath, JournalHeader& aHeader, std::vector<JournalRecord>& aRecords) {
+    aRecords.clear();
+    std::FILE* file = std::fopen(aFilePath.c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+    // общая часть всех версий, затем поля новых версий, которые есть в файле
+    std::memset(&aHeader, 0, sizeof(aHeader));
+    bool ok = std::fread(&aHeader, JournalHeaderV1Size, 1, file) == 1 &&
+              std::memcmp(aHeader.Magic, JournalMagic, sizeof(JournalMagic)) == 0 &&
+              aHeader.Version >= 1 && aHeader.Version <= Version &&
+              aHeader.RecordSize == sizeof(JournalRecord) && aHeader.HeaderSize >= JournalHeaderV1Size;
+    if (ok) {
+        const size_t extension = std::min<size_t>(aHeader.HeaderSize, sizeof(JournalHeader)) - JournalHeaderV1Size;
+        ok = extension == 0 ||
+             std::fread(reinterpret_cast<char*>(&aHeader) + JournalHeaderV1Size, extension, 1, file) == 1;
+    }
+    if (ok && aHeader.HeaderSize > sizeof(JournalHeader)) {
+        ok = std::fseek(file, aHeader.HeaderSize, SEEK_SET) == 0;
+    }
+    if (ok) {
+        JournalRecord record;
+        // недописанная последняя запись (падение во время записи) отбрасывается
+        while (std::fread(&record, sizeof(record), 1, file) == 1) {
+            aRecords.push_back(record);
+        }
+    }
+    std::fclose(file);
+    return ok;
+}
+
+}
@@ -0,0 +1,147 @@
+#ifndef RACE_JOURNAL_H_
+#define RACE_JOURNAL_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "BaseThread.h"
+#include "BoundedQueue.h"
+#include "Metrics.h"
+
+#include "./Defines.h"
+#include "./Settings.h"
+
+
+namespace Fatracing {
+
+// Формат журнала гонки (little-endian): заголовок JournalHeader, затем записи JournalRecord
+// фиксированного размера до конца файла. Файл только дописывается, поэтому после падения
+// процесса в нём остаётся всё, что было сброшено на диск; недописанная последняя запись
+// отбрасывается при чтении.
+#pragma pack(push, 1)
+struct JournalHeader {
+    char Magic[8];
+    uint32_t Version;
+    uint32_t HeaderSize;
+    uint32_t RecordSize;
+    uint32_t LaneCount;
+    int32_t RaceTimeSeconds;
+    // Версия 3: порог фальстарта, мс (в версиях 1-2 не заполнялся)
+    uint32_t FalseStartThresholdMs;
+    // Момент старта гонки: steady_clock (нс от эпохи часов) и системное время (мкс от 1970)
+    int64_t StartSteadyNs;
+    int64_t StartSystemUs;
+    char PortName[64];
+    // Версия 2: гонка на дистанцию (0 - на время) и метров на импульс по дорожкам
+    double RaceDistanceMeters;
+    double MetersPerPulse[2];
+};
+
+enum class JournalRecordType : uint8_t {
+    Start = 1,
+    Pulse = 2,
+    Tick = 3,
+    // Версия 3: фальстарт дорожки, время - импульс до сигнала старта
+    FalseStart = 4
+};
+
+struct JournalRecord {
+    // Время события, steady_clock, нс от эпохи часов
+    int64_t TimeNs;
+    JournalRecordType Type;
+    // Pulse, FalseStart: дорожка (RacersEnum); Tick: 1, если этим тиком гонка закончилась
+    uint8_t Lane;
+    uint16_t Reserved;
+    // Pulse: счёт дорожки после импульса; Tick: оставшиеся секунды
+    uint32_t Value;
+};
+#pragma pack(pop)
+
+// Заголовок версии 1 заканчивается на PortName
+static const size_t JournalHeaderV1Size = 112;
+static_assert(sizeof(JournalHeader) == 136, "JournalHeader layout");
+static_assert(sizeof(JournalRecord) == 16, "JournalRecord layout");
+
+// Журнал гонок: на каждую гонку отдельный файл race_<дата-время>.frj в заданном каталоге.
+// Race только кладёт записи в неблокирующую очередь; открытие файлов, запись крупными
+// буферизованными блоками и сброс на диск выполняются на отдельном потоке.
+// При переполнении очереди записи отбрасываются и считаются, Race никогда не ждёт.
+class RaceJournal : protected BaseThread {
+public:
+    static constexpr const char* FileExtension = ".frj";
+    static const uint32_t Version = 3;
+
+private:
+    // Служебные записи очереди: начало и конец файла гонки
+    static const uint8_t BeginMarker = 0xF0;
+    static const uint8_t EndMarker = 0xF1;
+
+    static const size_t QueueSize = 1 << 16;
+    static const size_t FileBufferSize = 256 * 1024;
+    // Как часто записанное сбрасывается из буфера в файл, мс
+    static const int FlushIntervalMs = 100;
+
+    std::string mDirectory;
+    BoundedQueue<JournalRecord> mQueue{QueueSize};
+    std::atomic<bool> mActive{false};
+
+    // Заголовки начатых гонок, которые поток записи ещё не открыл
+    std::mutex mHeadersMutex;
+    std::deque<JournalHeader> mHeaders;
+
+    std::FILE* mFile = nullptr;
+    std::vector<char> mFileBuffer;
+    std::string mFilePath;
+    std::atomic<uint64_t> mDropped{0};
+    uint64_t mDroppedAtBegin = 0;
+
+    MetricCounter& mRecordsMetric;
+    MetricCounter& mDroppedMetric;
+
+public:
+    explicit RaceJournal(const std::string& aDirectory);
+    ~RaceJournal();
+
+    // Начать файл новой гонки (вызывается из Race::Start)
+    void BeginRace(const SettingsStruct& aSettings, std::chrono::steady_clock::time_point aStartTime);
+    // Закончить файл гонки: сбросить и закрыть на потоке записи
+    void EndRace();
+
+    // Записи событий, не блокируются
+    void AddPulse(RacersEnum aRacer, std::chrono::steady_clock::time_point aTime, uint64_t aScore);
+    void AddTick(std::chrono::steady_clock::time_point aTime, int aSeconds, bool aFinish);
+    void AddFalseStart(RacersEnum aRacer, std::chrono::steady_clock::time_point aTime);
+
+    // Сколько записей отброшено из-за переполнения очереди
+    uint64_t GetDroppedCount() const { return mDropped; }
+
+    // Заголовок и записи журнала (для других получателей тех же событий)
+    static JournalHeader MakeHeader(const SettingsStruct& aSettings, std::chrono::steady_clock::time_point aStartTime);
+    static JournalRecord MakeStart(std::chrono::steady_clock::time_point aTime, int aRaceTimeSeconds);
+    static JournalRecord MakePulse(RacersEnum aRacer, std::chrono::steady_clock::time_point aTime, uint64_t aScore);
+    static JournalRecord MakeTick(std::chrono::steady_clock::time_point aTime, int aSeconds, bool aFinish);
+    static JournalRecord MakeFalseStart(RacersEnum aRacer, std::chrono::steady_clock::time_point aTime);
+
+    // Прочитать журнал целиком (версии 1-3), false если файл не открылся или это не журнал гонки
+    static bool ReadFile(const std::string& aFilePath, JournalHeader& aHeader, std::vector<JournalRecord>& aRecords);
+
+protected:
+    void ThreadFunc() override;
+
+private:
+    void Push(const JournalRecord& aRecord);
+    size_t Drain();
+    void OpenFile();
+    void CloseFile();
+};
+
+}
+
+#endif // RACE_JOURNAL_H_
@@ -0,0 +1,118 @@
+#include "./RaceReplay.h"
+
+#include <cstring>
+#include <thread>
+
+#include "Trace.h"
+
+
+namespace Fatracing {
+
+RaceReplay::RaceReplay() {
+    std::memset(&mHeader, 0, sizeof(mHeader));
+}
+
+bool RaceReplay::Load(const std::string& aFilePath) {
+    if (!RaceJournal::ReadFile(aFilePath, mHeader, mRecords)) {
+        LOGGER_LOG(PriorityEnum::Error, "Не удалось прочитать журнал гонки \"%s\"", aFilePath.c_str());
+        return false;
+    }
+    return true;
+}
+
+void RaceReplay::Assign(const JournalHeader& aHeader, std::vector<JournalRecord> aRecords) {
+    mHeader = aHeader;
+    mRecords = std::move(aRecords);
+}
+
+SettingsStruct RaceReplay::GetSettings() const {
+    SettingsStruct settings;
+    settings.RaceTimeSeconds = mHeader.RaceTimeSeconds;
+    settings.PortName = std::string(mHeader.PortName, strnlen(mHeader.PortName, sizeof(mHeader.PortName)));
+    settings.RaceDistanceMeters = mHeader.RaceDistanceMeters;
+    settings.FalseStartThresholdMs = static_cast<int>(mHeader.FalseStartThresholdMs);
+    for (size_t lane = 0; lane < settings.Lanes.size(); ++lane) {
+        if (mHeader.MetersPerPulse[lane] > 0.0) {
+            settings.Lanes[lane].RollerCircumferenceMeters = mHeader.MetersPerPulse[lane];
+            settings.Lanes[lane].Gearing = 1.0;
+        }
+    }
+    return settings;
+}
+
+ReplayResult RaceReplay::Run(Race& aRace) const {
+    TRACE_SCOPE("RaceReplay", "Run");
+    typedef std::chrono::steady_clock Clock;
+    ReplayResult result;
+
+    const auto replayStart = Clock::now();
+    const auto journalStart = Clock::time_point(std::chrono::nanoseconds(mHeader.StartSteadyNs));
+    // записанное время переносится на часы воспроизведения, интервалы между событиями сохраняются
+    const auto toReplayTime = [&](int64_t aTimeNs) {
+        return replayStart + (Clock::time_point(std::chrono::nanoseconds(aTimeNs)) - journalStart);
+    };
+
+    bool started = false;
+    for (const JournalRecord& record : mRecords) {
+        if (mStop && *mStop) {
+            break;
+        }
+        const auto time = toReplayTime(record.TimeNs);
+        if (mSpeed > 0.0) {
+            std::this_thread::sleep_until(replayStart + std::chrono::duration_cast<Clock::duration>(
+                (time - replayStart) / mSpeed));
+        }
+
+        switch (record.Type) {
+            case JournalRecordType::Start: {
+                aRace.StartManual(time);
+                started = true;
+                break;
+            }
+            case JournalRecordType::Pulse: {
+                if (!started) {
+                    break;
+                }
+                const RacersEnum racer = static_cast<RacersEnum>(record.Lane);
+                aRace.BlackBoxCallback(racer, time);
+                ++result.Pulses;
+                const auto snapshot = aRace.GetSnapshot();
+                const uint64_t score = racer == RacersEnum::BLUE ? snapshot->BlueScore : snapshot->RedScore;
+                if (score != record.Value) {
+                    ++result.Mismatches;
+                }
+                break;
+            }
+            case JournalRecordType::FalseStart: {
+                if (!started || record.Lane > static_cast<uint8_t>(RacersEnum::RED)) {
+                    break;
+                }
+                // импульс во время обратного отсчёта: Race должна признать его фальстартом
+                aRace.BlackBoxCallback(static_cast<RacersEnum>(record.Lane), time);
+                if (!aRace.GetSnapshot()->Starts[record.Lane].FalseStart) {
+                    ++result.Mismatches;
+                }
+                break;
+            }
+            case JournalRecordType::Tick: {
+                if (!started) {
+                    break;
+                }
+                aRace.Tick(time);
+                ++result.Ticks;
+                const auto snapshot = aRace.GetSnapshot();
+                if (snapshot->Seconds != static_cast<int>(record.Value) || snapshot->Finish != (record.Lane != 0)) {
+                    ++result.Mismatches;
+                }
+                break;
+            }
+        }
+    }
+
+    result.Final = aRace.GetSnapshot();
+    result.Truncated = !result.Final->ResultsFinal;
+    result.ElapsedSeconds = std::chrono::duration<double>(Clock::now() - replayStart).count();
+    return result;
+}
+
+}
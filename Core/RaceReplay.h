@@ -0,0 +1,62 @@
+#ifndef RACE_REPLAY_H_
+#define RACE_REPLAY_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "./Race.h"
+#include "./RaceJournal.h"
+
+
+namespace Fatracing {
+
+// Итог воспроизведения журнала
+struct ReplayResult {
+    uint64_t Pulses = 0;
+    uint64_t Ticks = 0;
+    // События, после которых состояние Race разошлось с записанным в журнале
+    uint64_t Mismatches = 0;
+    // Журнал закончился раньше окончательных результатов (гонка прервана или запись оборвалась)
+    bool Truncated = false;
+    RaceSnapshot Final;
+    double ElapsedSeconds = 0.0;
+};
+
+// Воспроизведение журнала гонки через настоящую логику Race на виртуальных часах.
+// Импульсы и тики подаются в Race в порядке журнала с записанными моментами времени (сдвинутыми
+// на момент начала воспроизведения), собственный таймер Race не используется. Скорость:
+// 0 - без пауз, так быстро, как успевает процессор; 1 - в реальном времени; N - в N раз быстрее.
+// После каждого события состояние Race сверяется с записанным в журнале.
+class RaceReplay {
+    JournalHeader mHeader;
+    std::vector<JournalRecord> mRecords;
+    double mSpeed = 0.0;
+    std::atomic<bool>* mStop = nullptr;
+
+public:
+    RaceReplay();
+
+    // Загрузить журнал, false если файл не прочитан
+    bool Load(const std::string& aFilePath);
+    // Взять уже прочитанный журнал
+    void Assign(const JournalHeader& aHeader, std::vector<JournalRecord> aRecords);
+
+    void SetSpeed(double aSpeed) { mSpeed = aSpeed; }
+    // Флаг досрочной остановки (например, по сигналу)
+    void SetStopFlag(std::atomic<bool>* aStop) { mStop = aStop; }
+
+    const JournalHeader& GetHeader() const { return mHeader; }
+    // Настройки гонки из заголовка журнала (журнал при воспроизведении не пишется)
+    SettingsStruct GetSettings() const;
+
+    // Прогнать журнал через aRace (созданную с GetSettings)
+    ReplayResult Run(Race& aRace) const;
+};
+
+}
+
+#endif // RACE_REPLAY_H_
@@ -0,0 +1,106 @@
+#include "./RaceSession.h"
+
+#include <cstring>
+
+#include "Trace.h"
+#include "Utils.h"
+
+#include "../Savers/Defines.h"
+
+
+namespace Fatracing {
+
+const size_t RaceSession::BatchRecords;
+const size_t RaceSession::MaxQueueSize;
+
+RaceSession::RaceSession(const SettingsStruct& aSettings) :
+    mBlocksMetric(Metrics::Instance().AddCounter("fatracing_session_blocks_total",
+                                                 "Race data blocks queued for the session recording")),
+    mDroppedMetric(Metrics::Instance().AddCounter("fatracing_session_dropped_total",
+                                                  "Race data blocks dropped: session queue full, size limit reached or write failed")) {
+    const tm t = Utils::TimeToTimeT(std::chrono::system_clock::now());
+    const std::string startDateTime = Utils::Format("%04u-%02u-%02u_%02u.%02u.%02u",
+        static_cast<unsigned int>(t.tm_year + 1900), static_cast<unsigned int>(t.tm_mon + 1),
+        static_cast<unsigned int>(t.tm_mday), static_cast<unsigned int>(t.tm_hour),
+        static_cast<unsigned int>(t.tm_min), static_cast<unsigned int>(t.tm_sec));
+    const uint64_t maxDataSize = aSettings.SessionMaxMegabytes << 20;
+
+    std::unique_ptr<SessionSaver> saver(new SessionSaver(aSettings.SessionDirectory));
+    // кадр не записан (предел SessionMaxMegabytes или ошибка записи) - блок гонки потерян
+    WrittenFrameCallback written = [this](std::string, uint64_t aNotWritten) {
+        if (aNotWritten != 0) {
+            ++mDropped;
+            mDroppedMetric.Increment();
+        }
+    };
+    if (!saver->InitSessionSaver(FolderName + "_", startDateTime, written, maxDataSize)) {
+        LOGGER_LOG(PriorityEnum::Error, "Не удалось начать запись сессии в \"%s\"", aSettings.SessionDirectory.c_str());
+        return;
+    }
+    mSaver = std::move(saver);
+    NewBatch();
+    LOGGER_LOG(PriorityEnum::Info, "Запись сессии в \"%s\"", aSettings.SessionDirectory.c_str());
+}
+
+RaceSession::~RaceSession() {
+    Flush();
+    // SessionSaver дописывает очередь и вызывает колбэк записи, пока члены RaceSession живы
+    mSaver.reset();
+}
+
+void RaceSession::BeginRace(const SettingsStruct& aSettings, std::chrono::steady_clock::time_point aStartTime) {
+    if (!mSaver) {
+        return;
+    }
+    Flush();
+    const JournalHeader header = RaceJournal::MakeHeader(aSettings, aStartTime);
+    std::shared_ptr<Data> data = std::make_shared<Data>();
+    data->time = std::chrono::system_clock::now();
+    data->data.resize(sizeof(header));
+    std::memcpy(data->data.data(), &header, sizeof(header));
+    Send(data);
+    Add(RaceJournal::MakeStart(aStartTime, aSettings.RaceTimeSeconds));
+}
+
+void RaceSession::EndRace() {
+    Flush();
+}
+
+void RaceSession::Add(const JournalRecord& aRecord) {
+    if (!mSaver) {
+        return;
+    }
+    std::vector<uint8_t>& data = mBatch->data;
+    const size_t size = data.size();
+    data.resize(size + sizeof(aRecord));
+    std::memcpy(data.data() + size, &aRecord, sizeof(aRecord));
+    if (data.size() >= BatchRecords * sizeof(JournalRecord)) {
+        Flush();
+    }
+}
+
+void RaceSession::Flush() {
+    if (!mSaver || mBatch->data.empty()) {
+        return;
+    }
+    Send(mBatch);
+    NewBatch();
+}
+
+void RaceSession::Send(std::shared_ptr<Data> aData) {
+    TRACE_SCOPE("RaceSession", "Send");
+    if (mSaver->HandleData(aData, MaxQueueSize)) {
+        mBlocksMetric.Increment();
+    } else {
+        ++mDropped;
+        mDroppedMetric.Increment();
+    }
+}
+
+void RaceSession::NewBatch() {
+    mBatch = std::make_shared<Data>();
+    mBatch->time = std::chrono::system_clock::now();
+    mBatch->data.reserve(BatchRecords * sizeof(JournalRecord));
+}
+
+}
@@ -0,0 +1,66 @@
+#ifndef RACE_SESSION_H_
+#define RACE_SESSION_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+
+#include "Metrics.h"
+
+#include "../Savers/SessionSaver.h"
+#include "./RaceJournal.h"
+#include "./Settings.h"
+
+
+namespace Fatracing {
+
+// Запись сессии на диск через SessionSaver: папка Session_<дата-время> на запуск программы,
+// в ней лог сессии и блоки данных гонок. Для каждой гонки первый блок - JournalHeader, дальше
+// блоки записей JournalRecord, поэтому блоки гонки, склеенные по порядку, образуют журнал .frj.
+// Блоки - кадры сегментов SessionSaver (SegmentFile.h), читаются по счётчику через SessionReader.
+// Race только дописывает записи в текущий блок; готовый блок (раз в тик или по заполнении)
+// уходит в очередь SessionSaver без ожидания, на диск его пишет поток SessionSaver.
+class RaceSession {
+    // Сколько записей собирать в блок до отправки, если тик ещё не пришёл
+    static const size_t BatchRecords = 4096;
+    // Сколько блоков может ждать записи; при переполнении блоки отбрасываются
+    static const size_t MaxQueueSize = 256;
+
+    std::unique_ptr<SessionSaver> mSaver;
+    std::shared_ptr<Data> mBatch;
+    std::atomic<uint64_t> mDropped{0};
+
+    MetricCounter& mBlocksMetric;
+    MetricCounter& mDroppedMetric;
+
+public:
+    explicit RaceSession(const SettingsStruct& aSettings);
+    ~RaceSession();
+
+    // Папка сессии создана, запись идёт
+    bool IsActive() const { return mSaver != nullptr; }
+
+    // Начало гонки: заголовок отдельным блоком, затем запись старта
+    void BeginRace(const SettingsStruct& aSettings, std::chrono::steady_clock::time_point aStartTime);
+    // Конец гонки: отправить недописанный блок
+    void EndRace();
+
+    // Записи событий, не блокируются
+    void Add(const JournalRecord& aRecord);
+    // Отправить текущий блок в очередь записи
+    void Flush();
+
+    // Сколько блоков отброшено: очередь переполнена, достигнут предел размера сессии или ошибка записи
+    uint64_t GetDroppedCount() const { return mDropped; }
+
+private:
+    void Send(std::shared_ptr<Data> aData);
+    void NewBatch();
+};
+
+}
+
+#endif // RACE_SESSION_H_
@@ -0,0 +1,120 @@
+#ifndef RACE_STATS_H_
+#define RACE_STATS_H_
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+
+#include "./PhotoFinish.h"
+
+
+namespace Fatracing {
+
+// Статистика гонки по дорожке. Память постоянная: отсечки ограничены MaxSplits
+struct LaneStats {
+    static const size_t MaxSplits = 16;
+
+    // Скорость по окну из последних импульсов, м/с: максимальная, средняя за гонку и её разброс
+    double TopSpeedMps = 0.0;
+    double AverageSpeedMps = 0.0;
+    double SpeedStdDevMps = 0.0;
+    // Равномерность: коэффициент вариации скорости по окнам (0 - идеально ровно)
+    double SpeedCv = 0.0;
+    // Максимальные обороты ролика в минуту по окну импульсов
+    double PeakCadenceRpm = 0.0;
+    // Время от старта до каждой отсечки (SplitMeters, 2 * SplitMeters, ...), мкс
+    std::array<int64_t, MaxSplits> SplitUs;
+    size_t SplitCount = 0;
+};
+
+typedef std::array<LaneStats, 2> RaceLaneStats;
+
+// Накопление LaneStats по мере прихода импульсов: O(1) на импульс, без хранения истории.
+// Скорость считается по окну из WindowPulses последних импульсов (кольцевой буфер моментов),
+// разброс - по Уэлфорду над скоростями непересекающихся окон.
+class LaneStatsAccumulator {
+public:
+    typedef std::chrono::steady_clock Clock;
+    static const size_t WindowPulses = 8;
+
+private:
+    LaneStats mStats;
+    double mMetersPerPulse = 0.0;
+    double mGearing = 1.0;
+    // Отсечка в импульсах и следующая ещё не пройденная отсечка
+    double mSplitPulses = 0.0;
+    double mNextSplitPulses = 0.0;
+    Clock::time_point mStartTime;
+
+    std::array<Clock::time_point, WindowPulses> mWindow;
+    uint64_t mCount = 0;
+
+    // Уэлфорд: число окон, среднее и сумма квадратов отклонений скорости
+    uint64_t mSamples = 0;
+    double mMean = 0.0;
+    double mM2 = 0.0;
+
+public:
+    LaneStatsAccumulator() {
+        mStats.SplitUs.fill(-1);
+    }
+
+    void Reset(Clock::time_point aStartTime, double aMetersPerPulse, double aGearing, double aSplitMeters) {
+        mStats = LaneStats();
+        mStats.SplitUs.fill(-1);
+        mMetersPerPulse = aMetersPerPulse;
+        mGearing = aGearing;
+        mSplitPulses = aMetersPerPulse > 0.0 && aSplitMeters > 0.0 ? aSplitMeters / aMetersPerPulse : 0.0;
+        mNextSplitPulses = mSplitPulses;
+        mStartTime = aStartTime;
+        mWindow.fill(aStartTime);
+        mCount = 0;
+        mSamples = 0;
+        mMean = 0.0;
+        mM2 = 0.0;
+    }
+
+    // Импульс дорожки; aTiming уже содержит этот импульс
+    void AddPulse(const LaneTiming& aTiming) {
+        const Clock::time_point time = aTiming.LastPulse;
+        // момент импульса WindowPulses назад (для первых импульсов - старт гонки)
+        Clock::time_point& slot = mWindow[mCount % WindowPulses];
+        const double span = std::chrono::duration<double>(time - slot).count();
+        slot = time;
+        ++mCount;
+
+        if (mCount >= WindowPulses && span > 0.0) {
+            const double pulsesPerSecond = WindowPulses / span;
+            const double speed = pulsesPerSecond * mMetersPerPulse;
+            mStats.TopSpeedMps = std::max(mStats.TopSpeedMps, speed);
+            mStats.PeakCadenceRpm = std::max(mStats.PeakCadenceRpm, pulsesPerSecond * mGearing * 60.0);
+            if (mCount % WindowPulses == 0) {
+                ++mSamples;
+                const double delta = speed - mMean;
+                mMean += delta / mSamples;
+                mM2 += delta * (speed - mMean);
+            }
+        }
+
+        while (mSplitPulses > 0.0 && mStats.SplitCount < LaneStats::MaxSplits &&
+               static_cast<double>(aTiming.Count) >= mNextSplitPulses) {
+            mStats.SplitUs[mStats.SplitCount++] = ToMicroseconds(aTiming.CrossingTime(mNextSplitPulses) - mStartTime);
+            mNextSplitPulses += mSplitPulses;
+        }
+    }
+
+    // Итог дорожки: пройдено aMeters за aElapsedUs от старта
+    const LaneStats& Finish(double aMeters, int64_t aElapsedUs) {
+        mStats.AverageSpeedMps = aElapsedUs > 0 ? aMeters / (aElapsedUs / 1e6) : 0.0;
+        mStats.SpeedStdDevMps = mSamples > 1 ? std::sqrt(mM2 / (mSamples - 1)) : 0.0;
+        mStats.SpeedCv = mMean > 0.0 ? mStats.SpeedStdDevMps / mMean : 0.0;
+        return mStats;
+    }
+};
+
+}
+
+#endif // RACE_STATS_H_
@@ -2,6 +2,10 @@
 
 
 namespace Fatracing {
+namespace {
+const char* LaneNodes[] = {"BlueLane", "RedLane"};
+}
+
 Settings::Settings() :
     BaseSettings("GoldSprintsSettings.xml", "GoldSprintsSettings") {
 }
@@ -9,33 +13,43 @@ Settings::Settings() :
 Settings::~Settings() {
 }
 
-SettingsStruct Settings::Parse(QXmlStreamReader& xml) {
+SettingsStruct Settings::Parse(const SettingsTree& aRoot) {
     SettingsStruct params;
 
-    while (!xml.atEnd()) {
-        QStringRef name = xml.name();
-        QString value = xml.readElementText();
-        if (name == QString::fromStdString("RaceTimeSeconds")) {
-            params.RaceTimeSeconds = value.toInt();
-        }
-        else if (name == QString::fromStdString("PortName")) {
-            params.PortName = value.toStdString();
-        }
-
-        xml.readNextStartElement();
+    params.RaceTimeSeconds = aRoot.get<int>("RaceTimeSeconds", 0);
+    params.PortName = aRoot.get<std::string>("PortName", "");
+    params.JournalDirectory = aRoot.get<std::string>("JournalDirectory", "");
+    params.SessionDirectory = aRoot.get<std::string>("SessionDirectory", "");
+    params.SessionMaxMegabytes = aRoot.get<uint64_t>("SessionMaxMegabytes", params.SessionMaxMegabytes);
+    params.RaceDistanceMeters = aRoot.get<double>("RaceDistanceMeters", 0.0);
+    params.SplitMeters = aRoot.get<double>("SplitMeters", params.SplitMeters);
+    params.CountdownSeconds = aRoot.get<int>("CountdownSeconds", params.CountdownSeconds);
+    params.FalseStartThresholdMs = aRoot.get<int>("FalseStartThresholdMs", params.FalseStartThresholdMs);
+    for (size_t lane = 0; lane < params.Lanes.size(); ++lane) {
+        const std::string node = LaneNodes[lane];
+        LaneSettings& laneSettings = params.Lanes[lane];
+        laneSettings.RollerCircumferenceMeters =
+            aRoot.get<double>(node + ".RollerCircumferenceMeters", laneSettings.RollerCircumferenceMeters);
+        laneSettings.Gearing = aRoot.get<double>(node + ".Gearing", laneSettings.Gearing);
     }
 
     return params;
 }
 
-void Settings::Save(QXmlStreamWriter& xml, const SettingsStruct& aSettings) {
-    auto writeElement = [&](std::string name, QString value) {
-        xml.writeStartElement(QString::fromStdString(name));
-        xml.writeCharacters(value);
-        xml.writeEndElement();
-    };
-
-    writeElement("RaceTimeSeconds", QString::number(aSettings.RaceTimeSeconds));
-    writeElement("PortName", QString::fromStdString(aSettings.PortName));
+void Settings::Save(SettingsTree& aRoot, const SettingsStruct& aSettings) {
+    aRoot.put("RaceTimeSeconds", aSettings.RaceTimeSeconds);
+    aRoot.put("PortName", aSettings.PortName);
+    aRoot.put("JournalDirectory", aSettings.JournalDirectory);
+    aRoot.put("SessionDirectory", aSettings.SessionDirectory);
+    aRoot.put("SessionMaxMegabytes", aSettings.SessionMaxMegabytes);
+    aRoot.put("RaceDistanceMeters", aSettings.RaceDistanceMeters);
+    aRoot.put("SplitMeters", aSettings.SplitMeters);
+    aRoot.put("CountdownSeconds", aSettings.CountdownSeconds);
+    aRoot.put("FalseStartThresholdMs", aSettings.FalseStartThresholdMs);
+    for (size_t lane = 0; lane < aSettings.Lanes.size(); ++lane) {
+        const std::string node = LaneNodes[lane];
+        aRoot.put(node + ".RollerCircumferenceMeters", aSettings.Lanes[lane].RollerCircumferenceMeters);
+        aRoot.put(node + ".Gearing", aSettings.Lanes[lane].Gearing);
+    }
 }
 } // namespace Fatracing
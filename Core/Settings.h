@@ -1,18 +1,48 @@
 #ifndef SETTINGS_H_
 #define SETTINGS_H_
 
+#include <array>
 #include <string>
 
 #include "BaseSettings.h"
 #include "Logger.h"
 #include "Singleton.h"
 
+#include "./Defines.h"
+
 
 namespace Fatracing {
 
+// Механика дорожки: сколько метров "проезжает" гонщик за один импульс датчика
+struct LaneSettings {
+    // Длина окружности ролика, м
+    double RollerCircumferenceMeters = 0.3456;
+    // Передаточное число: оборотов ролика на один импульс датчика
+    double Gearing = 1.0;
+
+    double MetersPerPulse() const { return RollerCircumferenceMeters * Gearing; }
+};
+
 struct SettingsStruct {
     std::string PortName;
+    // Гонка на время: длительность; гонка на дистанцию: ограничение по времени
     int RaceTimeSeconds;
+    // Дистанция гонки, м (0 - гонка на время)
+    double RaceDistanceMeters = 0.0;
+    // Обратный отсчёт перед стартом, с (0 - старт сразу)
+    int CountdownSeconds = 0;
+    // Импульс не раньше чем за столько мс до сигнала старта - фальстарт; более ранние не учитываются
+    int FalseStartThresholdMs = 500;
+    // Шаг отсечек в статистике гонки, м
+    double SplitMeters = 100.0;
+    // Настройки дорожек, индекс - RacersEnum
+    std::array<LaneSettings, 2> Lanes;
+    // Каталог журналов гонок (пустой - журнал не пишется)
+    std::string JournalDirectory;
+    // Каталог записи сессий: лог и данные гонок (пустой - сессия не пишется)
+    std::string SessionDirectory;
+    // Предел объёма данных сессии, МБ
+    uint64_t SessionMaxMegabytes = 500;
 };
 
 class Settings : public BaseSettings<SettingsStruct> {
@@ -25,8 +55,8 @@ private:
     ~Settings();
 
 protected:
-    SettingsStruct Parse(QXmlStreamReader& xml) override;
-    void Save(QXmlStreamWriter& xml, const SettingsStruct& aSettings) override;
+    SettingsStruct Parse(const SettingsTree& aRoot) override;
+    void Save(SettingsTree& aRoot, const SettingsStruct& aSettings) override;
 
 public:
     Settings(const Settings&) = delete;
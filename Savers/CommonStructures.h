@@ -0,0 +1,26 @@
+// Copyright 2018
+
+#pragma once
+
+#include <stdint.h>
+
+#include <chrono>
+#include <vector>
+
+namespace Fatracing
+{
+	//! Дополнительные файлы сессии
+	enum class FileType
+	{
+		Log
+	};
+
+	//! Блок данных для записи на диск
+	struct Data
+	{
+		//! Время блока (по нему называется файл)
+		std::chrono::system_clock::time_point time;
+		//! Содержимое
+		std::vector<uint8_t> data;
+	};
+}
@@ -2,10 +2,17 @@
 
 #pragma once
 
+#include <stdint.h>
+
 #include <string>
 
 namespace Fatracing
 {
-	const std::string FileExtension = ".vmt";
+	// Файлы-сегменты кадров сессии (SegmentFile.h)
+	const std::string FileExtension = ".vms";
+	// Размер сегмента, после которого кадры пишутся в следующий, байт
+	const uint64_t SegmentMaxSize = 64ull << 20;
 	const std::string FolderName = "Session";
+	// Сколько при остановке ждать записи оставшейся очереди, с
+	const int WaitQueueSeconds = 5;
 }
\ No newline at end of file
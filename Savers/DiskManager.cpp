@@ -10,10 +10,12 @@
 
 #include "Utils.h"
 #include "Defines.h"
+
+#include <algorithm>
 #include <boost/filesystem/operations.hpp>
 #include <boost/system/error_code.hpp>
 
-namespace VMM
+namespace Fatracing
 {
     using namespace boost::filesystem;
     using namespace boost::system;
@@ -79,7 +81,7 @@ namespace VMM
                 }
                 else
                 {
-                    LOGGER_LOG(PriorityEnum::Error, "Не удалось получить свободное место! Диск " + drive);
+                    LOGGER_LOG(PriorityEnum::Error, "Не удалось получить свободное место! Диск %s", drive.c_str());
                 }
 
                }
@@ -2,8 +2,9 @@
 
 #include "FileSaver.h"
 #include "Logger.h"
+#include "Trace.h"
 
-namespace VMM
+namespace Fatracing
 {
     FileSaver::FileSaver()
     {
@@ -29,6 +30,7 @@ namespace VMM
 
     bool FileSaver::WriteData(const std::string& aData)
     {
+        TRACE_SCOPE("Savers", "FileSaver::WriteData");
         if (mFile.is_open())
         {
             mFile << aData << std::endl;
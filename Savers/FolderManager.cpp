@@ -9,7 +9,7 @@
 
 #include <string>
 
-namespace VMM
+namespace Fatracing
 {
     using namespace boost::filesystem;
     using namespace boost::system;
@@ -57,7 +57,7 @@ namespace VMM
             }
             catch (const std::exception& ex)
             {
-                LOGGER_LOG(PriorityEnum::Error, ex.what());
+                LOGGER_LOG(PriorityEnum::Error, "%s", ex.what());
                 return false;
             }
         }
@@ -65,7 +65,7 @@ namespace VMM
         {
             if (!create_directory(mainFolderPath, error))
             {
-                LOGGER_LOG(PriorityEnum::Error, "Create directory " + mainFolderPath.string() + " failed!");
+                LOGGER_LOG(PriorityEnum::Error, "Create directory %s failed!", mainFolderPath.string().c_str());
                 return false;
             }
         }
@@ -76,7 +76,7 @@ namespace VMM
         // Create folder 
         if (!create_directory(folder, error))
         {
-            LOGGER_LOG(PriorityEnum::Error, "Create directory " + folder.string() + " failed!");
+            LOGGER_LOG(PriorityEnum::Error, "Create directory %s failed!", folder.string().c_str());
             return false;
         }
         
@@ -99,7 +99,7 @@ namespace VMM
         }
         catch (const std::exception& ex)
         {
-            LOGGER_LOG(PriorityEnum::Warning, ex.what());
+            LOGGER_LOG(PriorityEnum::Warning, "%s", ex.what());
 			folderSize = 0;
         }
 
@@ -115,7 +115,7 @@ namespace VMM
 			}
 			catch (const std::exception& ex)
 			{
-				LOGGER_LOG(PriorityEnum::Warning, ex.what());
+				LOGGER_LOG(PriorityEnum::Warning, "%s", ex.what());
 				folderSize = 0;
 			}
 
@@ -180,7 +180,7 @@ namespace VMM
             }
             catch (const std::exception& ex)
             {
-                LOGGER_LOG(PriorityEnum::Warning, ex.what());
+                LOGGER_LOG(PriorityEnum::Warning, "%s", ex.what());
             }
         }
 
@@ -198,7 +198,7 @@ namespace VMM
             }
             catch (const std::exception& ex)
             {
-                LOGGER_LOG(PriorityEnum::Warning, ex.what());
+                LOGGER_LOG(PriorityEnum::Warning, "%s", ex.what());
             }
         }
         return dataSize;
@@ -2,6 +2,11 @@
 
 #pragma once
 
+#include <stdint.h>
+
+#include <list>
+#include <string>
+
 #include <boost/filesystem/path.hpp>
 
 namespace Fatracing
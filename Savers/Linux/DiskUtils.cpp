@@ -0,0 +1,102 @@
+// Copyright 2018
+
+#include "DiskUtils.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/system/error_code.hpp>
+
+namespace Fatracing
+{
+namespace DiskUtils
+{
+	namespace
+	{
+		const char* MountsPath = "/proc/mounts";
+		const char* LabelsPath = "/dev/disk/by-label";
+
+		//! Строка /proc/mounts: устройство и точка монтирования (пробелы экранированы как \040)
+		bool ParseMount(const std::string& aLine, std::string& aDevice, std::string& aMountPoint)
+		{
+			std::istringstream stream(aLine);
+			if (!(stream >> aDevice >> aMountPoint))
+			{
+				return false;
+			}
+			std::string::size_type pos = 0;
+			while ((pos = aMountPoint.find("\\040", pos)) != std::string::npos)
+			{
+				aMountPoint.replace(pos, 4, " ");
+				++pos;
+			}
+			return true;
+		}
+
+		//! Путь устройства без символических ссылок
+		std::string Canonical(const std::string& aPath)
+		{
+			boost::system::error_code error;
+			const boost::filesystem::path path = boost::filesystem::canonical(aPath, error);
+			return error ? aPath : path.string();
+		}
+	}
+
+	std::vector<std::string> GetFixedDrives()
+	{
+		std::vector<std::string> drives;
+		std::ifstream mounts(MountsPath);
+		std::string line;
+		while (std::getline(mounts, line))
+		{
+			std::string device;
+			std::string mountPoint;
+			if (!ParseMount(line, device, mountPoint) || device.compare(0, 5, "/dev/") != 0 ||
+			    device.compare(0, 9, "/dev/loop") == 0)
+			{
+				continue;
+			}
+			device = Canonical(device);
+			if (std::find(drives.begin(), drives.end(), device) == drives.end())
+			{
+				drives.push_back(device);
+			}
+		}
+		return drives;
+	}
+
+	std::string GetDriveLabel(const std::string& aDrive)
+	{
+		boost::system::error_code error;
+		const std::string drive = Canonical(aDrive);
+		for (boost::filesystem::directory_iterator it(LabelsPath, error), end; !error && it != end; it.increment(error))
+		{
+			if (Canonical(it->path().string()) == drive)
+			{
+				return it->path().filename().string();
+			}
+		}
+		return "";
+	}
+
+	bool GetMountPoint(const std::string& aDrive, std::string& aMountPoint)
+	{
+		const std::string drive = Canonical(aDrive);
+		std::ifstream mounts(MountsPath);
+		std::string line;
+		while (std::getline(mounts, line))
+		{
+			std::string device;
+			std::string mountPoint;
+			if (ParseMount(line, device, mountPoint) && device.compare(0, 5, "/dev/") == 0 && Canonical(device) == drive)
+			{
+				aMountPoint = mountPoint;
+				return true;
+			}
+		}
+		return false;
+	}
+}
+}
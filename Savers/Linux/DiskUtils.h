@@ -0,0 +1,19 @@
+// Copyright 2018
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace Fatracing
+{
+namespace DiskUtils
+{
+	//! Смонтированные блочные устройства (/dev/...), без loop-устройств
+	std::vector<std::string> GetFixedDrives();
+	//! Метка файловой системы устройства (по /dev/disk/by-label), пустая если метки нет
+	std::string GetDriveLabel(const std::string& aDrive);
+	//! Точка монтирования устройства, false если устройство не смонтировано
+	bool GetMountPoint(const std::string& aDrive, std::string& aMountPoint);
+}
+}
@@ -0,0 +1,247 @@
+// Copyright 2018
+
+#include "SegmentFile.h"
+#include "Logger.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace Fatracing
+{
+	namespace
+	{
+		const char SegmentMagic[8] = {'F', 'R', 'S', 'E', 'G', '1', '\0', '\0'};
+		const char IndexMagic[8] = {'F', 'R', 'S', 'I', 'D', 'X', '1', '\0'};
+		const uint32_t SegmentVersion = 1;
+		//! Буфер записи сегмента
+		const size_t WriteBufferSize = 64 * 1024;
+
+		int64_t ToUs(std::chrono::system_clock::time_point aTime)
+		{
+			return std::chrono::duration_cast<std::chrono::microseconds>(aTime.time_since_epoch()).count();
+		}
+
+		// Сегменты ограничены SegmentMaxSize, поэтому смещения помещаются в long
+		bool Seek(std::FILE* aFile, uint64_t aOffset)
+		{
+			return std::fseek(aFile, static_cast<long>(aOffset), SEEK_SET) == 0;
+		}
+
+		bool ReadExact(std::FILE* aFile, void* aBuffer, size_t aSize)
+		{
+			return aSize == 0 || std::fread(aBuffer, aSize, 1, aFile) == 1;
+		}
+	}
+
+	SegmentWriter::~SegmentWriter()
+	{
+		Close();
+	}
+
+	bool SegmentWriter::Open(const std::string& aFilePath, uint64_t aFirstCounter)
+	{
+		Close();
+		mFile = std::fopen(aFilePath.c_str(), "wb");
+		if (!mFile)
+		{
+			LOGGER_LOG(PriorityEnum::Error, "Create segment %s failed!", aFilePath.c_str());
+			return false;
+		}
+		std::setvbuf(mFile, nullptr, _IOFBF, WriteBufferSize);
+		mFilePath = aFilePath;
+		mIndex.clear();
+
+		SegmentHeader header;
+		std::memset(&header, 0, sizeof(header));
+		std::memcpy(header.Magic, SegmentMagic, sizeof(header.Magic));
+		header.Version = SegmentVersion;
+		header.HeaderSize = sizeof(SegmentHeader);
+		header.FirstCounter = aFirstCounter;
+		header.CreatedUs = ToUs(std::chrono::system_clock::now());
+		if (std::fwrite(&header, sizeof(header), 1, mFile) != 1 || std::fflush(mFile) != 0)
+		{
+			LOGGER_LOG(PriorityEnum::Error, "Write segment header %s failed!", aFilePath.c_str());
+			std::fclose(mFile);
+			mFile = nullptr;
+			return false;
+		}
+		mSize = sizeof(header);
+		return true;
+	}
+
+	bool SegmentWriter::Append(uint64_t aCounter, const Data& aData)
+	{
+		TRACE_SCOPE("Savers", "SegmentWriter::Append");
+		if (!mFile)
+		{
+			return false;
+		}
+		SegmentRecordHeader record;
+		std::memset(&record, 0, sizeof(record));
+		record.Counter = aCounter;
+		record.TimeUs = ToUs(aData.time);
+		record.Size = static_cast<uint32_t>(aData.data.size());
+
+		// кадр сразу уходит из буфера в файл: после падения процесса в сегменте остаются все записанные кадры
+		const bool ok = std::fwrite(&record, sizeof(record), 1, mFile) == 1 &&
+		                (aData.data.empty() || std::fwrite(aData.data.data(), aData.data.size(), 1, mFile) == 1) &&
+		                std::fflush(mFile) == 0;
+		if (!ok)
+		{
+			// недописанный хвост перекрывается следующей записью
+			std::clearerr(mFile);
+			Seek(mFile, mSize);
+			return false;
+		}
+		SegmentIndexEntry entry;
+		entry.Counter = aCounter;
+		entry.Offset = mSize;
+		mIndex.push_back(entry);
+		mSize += sizeof(record) + aData.data.size();
+		return true;
+	}
+
+	bool SegmentWriter::Close()
+	{
+		if (!mFile)
+		{
+			return true;
+		}
+		SegmentFooter footer;
+		std::memset(&footer, 0, sizeof(footer));
+		footer.IndexOffset = mSize;
+		footer.IndexCount = mIndex.size();
+		std::memcpy(footer.Magic, IndexMagic, sizeof(footer.Magic));
+
+		bool ok = mIndex.empty() || std::fwrite(mIndex.data(), sizeof(SegmentIndexEntry), mIndex.size(), mFile) == mIndex.size();
+		ok = ok && std::fwrite(&footer, sizeof(footer), 1, mFile) == 1;
+		ok = std::fclose(mFile) == 0 && ok;
+		if (!ok)
+		{
+			LOGGER_LOG(PriorityEnum::Error, "Write segment index %s failed!", mFilePath.c_str());
+		}
+		mFile = nullptr;
+		mIndex.clear();
+		mSize = 0u;
+		return ok;
+	}
+
+	SegmentReader::~SegmentReader()
+	{
+		Close();
+	}
+
+	bool SegmentReader::Open(const std::string& aFilePath)
+	{
+		Close();
+		mFile = std::fopen(aFilePath.c_str(), "rb");
+		if (!mFile)
+		{
+			return false;
+		}
+		bool ok = ReadExact(mFile, &mHeader, sizeof(mHeader)) &&
+		          std::memcmp(mHeader.Magic, SegmentMagic, sizeof(SegmentMagic)) == 0 &&
+		          mHeader.Version == SegmentVersion && mHeader.HeaderSize >= sizeof(SegmentHeader) &&
+		          std::fseek(mFile, 0, SEEK_END) == 0;
+		const long fileSize = ok ? std::ftell(mFile) : -1;
+		ok = ok && fileSize >= static_cast<long>(mHeader.HeaderSize);
+		// сегмент без индекса (не закрыт) читается по записям
+		ok = ok && (ReadIndex(static_cast<uint64_t>(fileSize)) || ScanRecords(static_cast<uint64_t>(fileSize)));
+		if (!ok)
+		{
+			Close();
+		}
+		return ok;
+	}
+
+	void SegmentReader::Close()
+	{
+		if (mFile)
+		{
+			std::fclose(mFile);
+			mFile = nullptr;
+		}
+		mIndex.clear();
+		mClosed = false;
+	}
+
+	bool SegmentReader::ReadIndex(uint64_t aFileSize)
+	{
+		SegmentFooter footer;
+		if (aFileSize < mHeader.HeaderSize + sizeof(footer) || !Seek(mFile, aFileSize - sizeof(footer)) ||
+		    !ReadExact(mFile, &footer, sizeof(footer)) || std::memcmp(footer.Magic, IndexMagic, sizeof(IndexMagic)) != 0 ||
+		    footer.IndexOffset + footer.IndexCount * sizeof(SegmentIndexEntry) + sizeof(footer) != aFileSize)
+		{
+			return false;
+		}
+		mIndex.resize(static_cast<size_t>(footer.IndexCount));
+		if (!Seek(mFile, footer.IndexOffset) ||
+		    !ReadExact(mFile, mIndex.data(), mIndex.size() * sizeof(SegmentIndexEntry)))
+		{
+			mIndex.clear();
+			return false;
+		}
+		mClosed = true;
+		return true;
+	}
+
+	bool SegmentReader::ScanRecords(uint64_t aFileSize)
+	{
+		mIndex.clear();
+		uint64_t offset = mHeader.HeaderSize;
+		SegmentRecordHeader record;
+		while (offset + sizeof(record) <= aFileSize && Seek(mFile, offset) && ReadExact(mFile, &record, sizeof(record)))
+		{
+			const uint64_t end = offset + sizeof(record) + record.Size;
+			if (end > aFileSize)
+			{
+				// недописанная последняя запись
+				break;
+			}
+			SegmentIndexEntry entry;
+			entry.Counter = record.Counter;
+			entry.Offset = offset;
+			mIndex.push_back(entry);
+			offset = end;
+		}
+		return true;
+	}
+
+	bool SegmentReader::Find(uint64_t aCounter, size_t& aPosition) const
+	{
+		// счётчики внутри сегмента возрастают: SessionSaver нумерует кадры подряд
+		const auto it = std::lower_bound(mIndex.begin(), mIndex.end(), aCounter,
+			[](const SegmentIndexEntry& aEntry, uint64_t aValue) { return aEntry.Counter < aValue; });
+		if (it == mIndex.end() || it->Counter != aCounter)
+		{
+			return false;
+		}
+		aPosition = static_cast<size_t>(it - mIndex.begin());
+		return true;
+	}
+
+	bool SegmentReader::ReadAt(size_t aPosition, Data& aData)
+	{
+		if (!mFile || aPosition >= mIndex.size())
+		{
+			return false;
+		}
+		SegmentRecordHeader record;
+		if (!Seek(mFile, mIndex[aPosition].Offset) || !ReadExact(mFile, &record, sizeof(record)) ||
+		    record.Counter != mIndex[aPosition].Counter)
+		{
+			return false;
+		}
+		aData.time = std::chrono::system_clock::time_point(std::chrono::duration_cast<std::chrono::system_clock::duration>(
+			std::chrono::microseconds(record.TimeUs)));
+		aData.data.resize(record.Size);
+		return ReadExact(mFile, aData.data.data(), aData.data.size());
+	}
+
+	bool SegmentReader::Read(uint64_t aCounter, Data& aData)
+	{
+		size_t position = 0;
+		return Find(aCounter, position) && ReadAt(position, aData);
+	}
+}
@@ -0,0 +1,127 @@
+// Copyright 2018
+
+#pragma once
+
+#include <stdint.h>
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "CommonStructures.h"
+
+namespace Fatracing
+{
+	// Файл-сегмент (little-endian): SegmentHeader, затем записи кадров (SegmentRecordHeader и данные)
+	// подряд; при закрытии дописывается индекс (SegmentIndexEntry на каждый кадр) и SegmentFooter.
+	// Файл только дописывается: если сегмент не закрыт (падение), индекс восстанавливается
+	// чтением записей от начала, недописанная последняя запись отбрасывается.
+#pragma pack(push, 1)
+	struct SegmentHeader
+	{
+		char Magic[8];
+		uint32_t Version;
+		uint32_t HeaderSize;
+		//! Счётчик первого кадра сегмента
+		uint64_t FirstCounter;
+		//! Время создания сегмента, мкс от 1970
+		int64_t CreatedUs;
+	};
+
+	struct SegmentRecordHeader
+	{
+		uint64_t Counter;
+		//! Время кадра (Data::time), мкс от 1970
+		int64_t TimeUs;
+		uint32_t Size;
+		uint32_t Reserved;
+	};
+
+	struct SegmentIndexEntry
+	{
+		uint64_t Counter;
+		//! Смещение SegmentRecordHeader от начала файла
+		uint64_t Offset;
+	};
+
+	struct SegmentFooter
+	{
+		uint64_t IndexOffset;
+		uint64_t IndexCount;
+		char Magic[8];
+	};
+#pragma pack(pop)
+
+	static_assert(sizeof(SegmentHeader) == 32, "SegmentHeader layout");
+	static_assert(sizeof(SegmentRecordHeader) == 24, "SegmentRecordHeader layout");
+	static_assert(sizeof(SegmentIndexEntry) == 16, "SegmentIndexEntry layout");
+	static_assert(sizeof(SegmentFooter) == 24, "SegmentFooter layout");
+
+	//! Запись кадров в сегмент. Кадр сразу сбрасывается из буфера в файл, индекс копится в памяти
+	//! и пишется при закрытии
+	class SegmentWriter
+	{
+		std::FILE* mFile = nullptr;
+		std::string mFilePath;
+		uint64_t mSize = 0u;
+		std::vector<SegmentIndexEntry> mIndex;
+
+	public:
+		SegmentWriter() = default;
+		~SegmentWriter();
+
+		SegmentWriter(const SegmentWriter&) = delete;
+		SegmentWriter& operator=(const SegmentWriter&) = delete;
+
+		//! Создать сегмент, первый кадр которого будет aFirstCounter
+		bool Open(const std::string& aFilePath, uint64_t aFirstCounter);
+		//! Дописать кадр; false - ошибка записи (запись кадра считается не сделанной)
+		bool Append(uint64_t aCounter, const Data& aData);
+		//! Дописать индекс и закрыть
+		bool Close();
+
+		bool IsOpen() const { return mFile != nullptr; }
+		const std::string& GetFilePath() const { return mFilePath; }
+		//! Текущий размер файла, байт
+		uint64_t GetSize() const { return mSize; }
+		size_t GetCount() const { return mIndex.size(); }
+	};
+
+	//! Чтение сегмента: индекс из хвоста файла (или по записям, если сегмент не закрыт),
+	//! поиск кадра по счётчику двоичным поиском по индексу
+	class SegmentReader
+	{
+		std::FILE* mFile = nullptr;
+		SegmentHeader mHeader;
+		std::vector<SegmentIndexEntry> mIndex;
+		//! Индекс прочитан из хвоста (сегмент закрыт)
+		bool mClosed = false;
+
+	public:
+		SegmentReader() = default;
+		~SegmentReader();
+
+		SegmentReader(const SegmentReader&) = delete;
+		SegmentReader& operator=(const SegmentReader&) = delete;
+
+		bool Open(const std::string& aFilePath);
+		void Close();
+
+		const SegmentHeader& GetHeader() const { return mHeader; }
+		bool IsClosedSegment() const { return mClosed; }
+		size_t GetCount() const { return mIndex.size(); }
+		uint64_t GetCounter(size_t aPosition) const { return mIndex[aPosition].Counter; }
+
+		//! Позиция кадра в индексе, false если кадра в сегменте нет
+		bool Find(uint64_t aCounter, size_t& aPosition) const;
+		//! Прочитать кадр по позиции в индексе
+		bool ReadAt(size_t aPosition, Data& aData);
+		//! Прочитать кадр по счётчику
+		bool Read(uint64_t aCounter, Data& aData);
+
+	private:
+		bool ReadIndex(uint64_t aFileSize);
+		bool ScanRecords(uint64_t aFileSize);
+	};
+}
@@ -0,0 +1,52 @@
+// Copyright 2018
+
+#include "SessionReader.h"
+#include "Defines.h"
+#include "Logger.h"
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/filesystem/path.hpp>
+#include <boost/system/error_code.hpp>
+
+namespace Fatracing
+{
+	bool SessionReader::Open(const std::string& aSessionFolderPath)
+	{
+		Close();
+
+		boost::system::error_code error;
+		for (boost::filesystem::directory_iterator it(aSessionFolderPath, error), end; !error && it != end; it.increment(error))
+		{
+			if (it->path().extension().string() != FileExtension)
+			{
+				continue;
+			}
+			std::unique_ptr<SegmentReader> segment(new SegmentReader());
+			if (!segment->Open(it->path().string()))
+			{
+				LOGGER_LOG(PriorityEnum::Warning, "Open segment %s failed!", it->path().string().c_str());
+				continue;
+			}
+			mFrameCount += segment->GetCount();
+			mSegments[segment->GetHeader().FirstCounter] = std::move(segment);
+		}
+		return !mSegments.empty();
+	}
+
+	void SessionReader::Close()
+	{
+		mSegments.clear();
+		mFrameCount = 0u;
+	}
+
+	bool SessionReader::Read(uint64_t aFrameCounter, Data& aData)
+	{
+		auto itr = mSegments.upper_bound(aFrameCounter);
+		if (itr == mSegments.begin())
+		{
+			return false;
+		}
+		--itr;
+		return itr->second->Read(aFrameCounter, aData);
+	}
+}
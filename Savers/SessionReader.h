@@ -0,0 +1,53 @@
+// Copyright 2018
+
+#pragma once
+
+#include <stdint.h>
+
+#include <map>
+#include <memory>
+#include <string>
+
+#include "CommonStructures.h"
+#include "SegmentFile.h"
+
+namespace Fatracing
+{
+	//! Чтение кадров сессии из папки с сегментами SessionSaver. Индексы сегментов читаются один раз
+	//! при открытии; кадр ищется по счетчику: сегмент по ближайшему меньшему первому кадру,
+	//! затем двоичный поиск по индексу сегмента
+	class SessionReader
+	{
+		//! Сегменты: счетчик первого кадра -> чтение сегмента
+		std::map<uint64_t, std::unique_ptr<SegmentReader>> mSegments;
+		size_t mFrameCount = 0u;
+
+	public:
+		//! Открыть папку сессии, false если в ней нет ни одного читаемого сегмента
+		bool Open(const std::string& aSessionFolderPath);
+		void Close();
+
+		size_t GetSegmentCount() const { return mSegments.size(); }
+		size_t GetFrameCount() const { return mFrameCount; }
+
+		//! Прочитать кадр по счетчику, false если такого кадра нет
+		bool Read(uint64_t aFrameCounter, Data& aData);
+		//! Обойти кадры по порядку счетчиков; aCallback возвращает false, чтобы остановиться
+		template <typename Callback>
+		bool ForEach(Callback aCallback)
+		{
+			Data data;
+			for (auto& segment : mSegments)
+			{
+				for (size_t position = 0; position < segment.second->GetCount(); ++position)
+				{
+					if (!segment.second->ReadAt(position, data) || !aCallback(segment.second->GetCounter(position), data))
+					{
+						return false;
+					}
+				}
+			}
+			return true;
+		}
+	};
+}
@@ -4,12 +4,16 @@
 #include "Logger.h"
 #include "Utils.h"
 #include "Defines.h"
+#include "Trace.h"
 
 #include <boost/filesystem/path.hpp>
 #include <boost/filesystem/operations.hpp>
 #include <boost/system/error_code.hpp>
 
-namespace VMM
+#include <chrono>
+#include <thread>
+
+namespace Fatracing
 {
 	using namespace boost::filesystem;
 	using namespace boost::system;
@@ -24,7 +28,10 @@ namespace VMM
 	{
         Logger::Instance().RemoveCallback(mLoggerUserName);
 
+        // остановка потока отбрасывает очередь, поэтому сначала дописываем её
+        WaitQueue();
         StopThread();
+        mSegment.Close();
 	}
 
     std::string 
@@ -45,7 +52,7 @@ namespace VMM
         std::string fileName = GetFileName(aFileType);
         if (fileName.empty())
         {
-            LOGGER_LOG(PriorityEnum::Error, Utils::Format("Init file %d failed!", aFileType));
+            LOGGER_LOG(PriorityEnum::Error, "Init file %d failed!", static_cast<int>(aFileType));
         }
         else
         {
@@ -58,7 +65,7 @@ namespace VMM
             }
             else
             {
-                LOGGER_LOG(PriorityEnum::Error, "Init file " + filePath + " failed!");
+                LOGGER_LOG(PriorityEnum::Error, "Init file %s failed!", filePath.c_str());
             }
         }
     }
@@ -74,6 +81,7 @@ namespace VMM
 	SessionSaver::InitSessionSaver(const std::string& aSessionFolderName, const std::string& aStartDateTime, WrittenFrameCallback aWriteFrameCallback, uint64_t aMaxDataSize)
 	{
         mMaxDataSize = aMaxDataSize;
+        mLimitReached = false;
         mStartDateTime = aStartDateTime;
         // mSessionFolderName = aSessionFolderName + aStartDateTime;
 //#ifdef _WIN32
@@ -85,6 +93,7 @@ namespace VMM
 		{   
             // Stop processing thread if it was started
             StopThread();
+            mSegment.Close();
 
             // Init folder manager
 			if (!mFolderManager.Init(mFolderPath, mSessionFolderName, aSessionFolderName))
@@ -110,13 +119,13 @@ namespace VMM
             // Start processing thread
 			if (!StartThread())
 			{
-				LOGGER_LOG(PriorityEnum::Error, "Start Session save thread for " + mFolderPath + mSessionFolderName + " failed!");
+				LOGGER_LOG(PriorityEnum::Error, "Start Session save thread for %s%s failed!", mFolderPath.c_str(), mSessionFolderName.c_str());
 				return false;
 			}
 		}
 		catch (const std::exception& ex)
 		{
-			LOGGER_LOG(PriorityEnum::Error, ex.what());
+			LOGGER_LOG(PriorityEnum::Error, "%s", ex.what());
 			return false;
 		}
 		return true;
@@ -137,28 +146,10 @@ namespace VMM
 	void 
 	SessionSaver::HandleWorkItem(std::shared_ptr<Data> aItem)
 	{
+		TRACE_SCOPE("Savers", "SessionSaver::HandleWorkItem");
 		size_t dataSize = aItem->data.size();
 		size_t freeSize = 0;
 
-		/* ЛОГИКА ЦИКЛИЧЕСКОЙ ПОСЕАНСОВОЙ ПЕРЕЗАПИСИ
-		if (mFolderManager.IsOtherFolderExists() && mCurrentDataSize + dataSize > mMaxDataSize)
-		{
-		freeSize += mFolderManager.RemoveOtherFolder();
-		}
-
-		while (mFolderManager.IsAnyOldFolderExists() && mCurrentDataSize - freeSize + dataSize > mMaxDataSize)
-		{
-		freeSize += mFolderManager.RemoveOldestFolder();
-		}
-
-		if (mCurrentDataSize - freeSize + dataSize > mMaxDataSize)
-		{
-		freeSize += mSessionSaver.FreeData(mCurrentDataSize + dataSize - mMaxDataSize);
-		}
-
-		mCurrentDataSize -= freeSize;*/
-
-
 		// если писать некуда, то не пишем и выкидываем сообщение об ошибке
 		if (mCurrentDataSize + dataSize <= mMaxDataSize)
 		{
@@ -171,9 +162,22 @@ namespace VMM
 				freeSize = 1;
 		}
 		else
+		{
+			if (!mLimitReached)
+			{
+				// предупреждение один раз за сессию, дальше кадры только считаются
+				mLimitReached = true;
+				LOGGER_LOG(PriorityEnum::Warning, "Session data limit %llu bytes reached for %s%s, frames are discarded!",
+					static_cast<unsigned long long>(mMaxDataSize), mFolderPath.c_str(), mSessionFolderName.c_str());
+			}
 			freeSize = 2;
+		}
 
-		// теперь freeSize используется в контексте что записи не произошло так как писать больше некуда либо ошибка при записи			
+		// теперь freeSize используется в контексте что записи не произошло так как писать больше некуда либо ошибка при записи
+		if (freeSize != 0)
+		{
+			++mDroppedFrames;
+		}
 		if (mWriteFrameCallback)
 			mWriteFrameCallback(mFolderPath + mSessionFolderName, freeSize);
 	}
@@ -203,77 +207,40 @@ namespace VMM
 		return (mMaxDataSize - mCurrentDataSize);
 	}
 
-	size_t SessionSaver::HandleFrameData(std::shared_ptr<Data> aData)
+	uint64_t SessionSaver::HandleFrameData(std::shared_ptr<Data> aData)
 	{
 		size_t dataSize = aData->data.size();
+		++mFrameCounter;
 
-		if (mMaxFrameCounter != 0u && mFrameCounter == mMaxFrameCounter)
-		{
-			// Reset frame counter 
-			mFrameCounter = 0u;
-		}
-
-		// Remove old file with same frame counter if exists
-		auto itr = mFramesMap.find(++mFrameCounter);
-		if (itr != mFramesMap.end())
+		if (mSegment.IsOpen() && mSegment.GetSize() + sizeof(SegmentRecordHeader) + dataSize > SegmentMaxSize)
 		{
-			remove(itr->second.c_str());
+			mSegment.Close();
 		}
 
 		// Save frame
-		std::string filePath = mFolderPath + mSessionFolderName + Utils::Format("%.6u_", mFrameCounter) + Utils::FormatFileName(aData->time) + FileExtension;
-		std::ofstream file(filePath, std::ios::out | std::ios::binary);
-		if (file.is_open())
+		if ((!mSegment.IsOpen() && !OpenSegment(mFrameCounter, aData->time)) || !mSegment.Append(mFrameCounter, *aData))
 		{
-			file.write((const char*)&aData->data[0], dataSize);
-
-			file.close();
-			if (!file)
-			{
-				// error handling
-				LOGGER_LOG(PriorityEnum::Error, "Save frame for " + mFolderPath + " failed!");
-				dataSize = 0;
-			}
-			else
-			{
-				// Add writtn file to file map
-				mFramesMap[mFrameCounter] = filePath;
-			}
-		}
-		else
-		{
-			LOGGER_LOG(PriorityEnum::Error, "Save frame for " + mFolderPath + " failed!");
+			LOGGER_LOG(PriorityEnum::Error, "Save frame for %s failed!", mFolderPath.c_str());
 			dataSize = 0;
 		}
 
-		return mMaxFrameCounter == 0 ? dataSize : 0;
+		return dataSize;
 	}
 
-	uint64_t SessionSaver::FreeFrameData(uint64_t aRequiredSize)
+	bool SessionSaver::OpenSegment(unsigned long aFrameCounter, std::chrono::system_clock::time_point aTime)
 	{
-		uint64_t dataRemoved = 0;
-
-		if (mFolderManager.IsOtherFolderExists())
-		{
-			// reduce required size
-			dataRemoved += mFolderManager.RemoveOtherFolder();
-		}
+		char frameCounter[24];
+		Utils::FormatTo(frameCounter, sizeof(frameCounter), "%.6lu_", aFrameCounter);
+		std::string filePath = mFolderPath + mSessionFolderName + frameCounter + Utils::FormatFileName(aTime) + FileExtension;
+		return mSegment.Open(filePath, aFrameCounter);
+	}
 
-		if (mMaxFrameCounter == 0)
+	void SessionSaver::WaitQueue()
+	{
+		const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(WaitQueueSeconds);
+		while (BaseThread::IsThreadActive() && GetQueueSize() > 0 && std::chrono::steady_clock::now() < deadline)
 		{
-			// Remove old sessions until get required free space
-			while (aRequiredSize - dataRemoved > 0 && mFolderManager.IsAnyOldFolderExists())
-			{
-				// reduce required size
-				dataRemoved += mFolderManager.RemoveOldestFolder();
-			}
-
-			if (aRequiredSize - dataRemoved > 0)
-			{
-				mMaxFrameCounter = mFrameCounter;
-			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
 		}
-
-		return dataRemoved;
 	}
 }
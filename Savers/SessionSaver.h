@@ -5,11 +5,16 @@
 #include "SessionSaver.h"
 #include "FileSaver.h"
 #include "FolderManager.h"
+#include "SegmentFile.h"
 #include "CommonStructures.h"
 #include "AsyncQueue.h"
 #include "Logger.h"
 
+#include <atomic>
+#include <functional>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <string>
 
 namespace Fatracing
@@ -34,10 +39,12 @@ namespace Fatracing
 
 		// Счетчик кадров
 		unsigned long mFrameCounter = 0u;
-		// Максимальное значение счетчика кадров
-		unsigned long mMaxFrameCounter = 0u;
-		// Карта кадров
-		std::map<unsigned long, std::string> mFramesMap;
+		// Текущий сегмент
+		SegmentWriter mSegment;
+		// Кадры, не записанные из-за предела размера данных или ошибки записи
+		std::atomic<uint64_t> mDroppedFrames{0u};
+		// Предел размера данных достигнут (предупреждение уже в логе)
+		bool mLimitReached = false;
 
         // Мьютекс карты файлов
         std::mutex mFilesMapMutex;
@@ -58,8 +65,10 @@ namespace Fatracing
 
 		// Обработка кадра
 		uint64_t HandleFrameData(std::shared_ptr<Data> aData);
-		// Освобождение места
-		uint64_t FreeFrameData(uint64_t aRequiredSize);
+		// Дождаться записи очереди (при остановке)
+		void WaitQueue();
+		// Начать сегмент с кадра aFrameCounter
+		bool OpenSegment(unsigned long aFrameCounter, std::chrono::system_clock::time_point aTime);
 
     protected:
         void HandleWorkItem(std::shared_ptr<Data> aItem) override;
@@ -78,6 +87,8 @@ namespace Fatracing
         bool WriteFile(FileType aFileType, const std::string& aData);
 		//! Получить размер оставшегося свободного пространства
 		uint64_t GetCurrentFreeSize();
+		//! Сколько кадров не записано (предел размера данных, ошибка записи)
+		uint64_t GetDroppedFrameCount() const { return mDroppedFrames; }
     };
 }
 
@@ -0,0 +1,248 @@
+// Copyright 2018
+
+// Длительный прогон (soak test) Race + BlackBox на имитаторе импульсов (pty).
+// Гонки идут подряд без пауз на высокой частоте по обеим дорожкам. Раз в --sample-interval
+// секунд снимаются RSS, число потоков, открытые дескрипторы, очереди логгера, отброшенные записи
+// лога и отставание принятых импульсов от отправленных имитатором. После прогрева
+// (первые 10% времени) для каждой метрики сравниваются медианы первой и последней четверти
+// замеров: если метрика выросла больше допуска, прогон считается проваленным (код возврата 1).
+// В конце имитатор останавливается и принятые импульсы сверяются с отправленными точно.
+//
+// soak [--duration <sec>] [--race-time <sec>] [--rate <pps>] [--sample-interval <sec>] [--csv <file>]
+
+#include <signal.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "BinaryLog.h"
+#include "Logger.h"
+#include "ProcessStats.h"
+
+#include "BlackBox/PulseSimulator.h"
+#include "Core/Race.h"
+
+using namespace Fatracing;
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+struct SoakOptions {
+	double DurationSeconds = 12 * 3600.0;
+	int RaceTimeSeconds = 30;
+	double Rate = 40.0;
+	double SampleIntervalSeconds = 10.0;
+	const char* CsvPath = nullptr;
+};
+
+//! Метрика и допуск на её рост между началом и концом прогона
+struct Metric {
+	const char* Name;
+	//! Допустимый рост в абсолютных единицах
+	double AbsoluteTolerance;
+	//! Допустимый рост относительно начального значения
+	double RelativeTolerance;
+	std::vector<double> Values;
+};
+
+enum MetricIndex {
+	ResidentBytes,
+	Threads,
+	OpenFiles,
+	LogQueueSize,
+	LogDropped,
+	PulseLag,
+	MetricCount
+};
+
+std::atomic<bool> gStop{false};
+
+void OnSignal(int) {
+	gStop = true;
+}
+
+bool ParseOptions(int argc, char* argv[], SoakOptions& aOptions) {
+	for (int i = 1; i < argc; ++i) {
+		const bool hasValue = i + 1 < argc;
+		if (std::strcmp(argv[i], "--duration") == 0 && hasValue) {
+			aOptions.DurationSeconds = std::atof(argv[++i]);
+		} else if (std::strcmp(argv[i], "--race-time") == 0 && hasValue) {
+			aOptions.RaceTimeSeconds = std::atoi(argv[++i]);
+		} else if (std::strcmp(argv[i], "--rate") == 0 && hasValue) {
+			aOptions.Rate = std::atof(argv[++i]);
+		} else if (std::strcmp(argv[i], "--sample-interval") == 0 && hasValue) {
+			aOptions.SampleIntervalSeconds = std::atof(argv[++i]);
+		} else if (std::strcmp(argv[i], "--csv") == 0 && hasValue) {
+			aOptions.CsvPath = argv[++i];
+		} else {
+			return false;
+		}
+	}
+	return aOptions.DurationSeconds > 0.0 && aOptions.Rate > 0.0 && aOptions.SampleIntervalSeconds > 0.0;
+}
+
+double Median(std::vector<double> aValues) {
+	if (aValues.empty()) {
+		return 0.0;
+	}
+	std::nth_element(aValues.begin(), aValues.begin() + aValues.size() / 2, aValues.end());
+	return aValues[aValues.size() / 2];
+}
+
+//! Проверка тренда: медиана последней четверти замеров после прогрева против первой
+bool CheckTrend(const Metric& aMetric) {
+	const size_t warmup = aMetric.Values.size() / 10;
+	const size_t count = aMetric.Values.size() - warmup;
+	if (count < 8) {
+		std::fprintf(stderr, "%-16s not enough samples (%zu)\n", aMetric.Name, count);
+		return true;
+	}
+	const size_t quarter = count / 4;
+	const auto begin = aMetric.Values.begin() + warmup;
+	const double first = Median(std::vector<double>(begin, begin + quarter));
+	const double last = Median(std::vector<double>(aMetric.Values.end() - quarter, aMetric.Values.end()));
+	const double limit = first + std::max(aMetric.AbsoluteTolerance, aMetric.RelativeTolerance * first);
+	const bool ok = last <= limit;
+	std::fprintf(stderr, "%-16s first %14.0f last %14.0f limit %14.0f  %s\n",
+	             aMetric.Name, first, last, limit, ok ? "ok" : "TRENDING UP");
+	return ok;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+	SoakOptions options;
+	if (!ParseOptions(argc, argv, options)) {
+		std::fprintf(stderr,
+		             "Usage: %s [--duration <sec>] [--race-time <sec>] [--rate <pulses/s per lane>] "
+		             "[--sample-interval <sec>] [--csv <file>]\n", argv[0]);
+		return 2;
+	}
+	signal(SIGINT, OnSignal);
+	signal(SIGTERM, OnSignal);
+
+	std::vector<Metric> metrics = {
+		{"rss_bytes", 4.0 * 1024 * 1024, 0.05, {}},
+		{"threads", 0.0, 0.0, {}},
+		{"open_files", 0.0, 0.0, {}},
+		{"log_queue", 64.0, 0.0, {}},
+		{"log_dropped", 0.0, 0.0, {}},
+		// импульсы в пути между имитатором и Race: до полсекунды по обеим дорожкам
+		{"pulse_lag", options.Rate, 0.0, {}},
+	};
+
+	PulseSimulator simulator;
+	if (!simulator.Open()) {
+		std::fprintf(stderr, "Cannot open pty simulator\n");
+		return 1;
+	}
+	simulator.SetRate(RacersEnum::BLUE, options.Rate);
+	simulator.SetRate(RacersEnum::RED, options.Rate);
+
+	SettingsStruct settings;
+	settings.PortName = simulator.GetPortName();
+	settings.RaceTimeSeconds = options.RaceTimeSeconds;
+
+	std::atomic<uint64_t> racesFinished{0};
+	std::atomic<bool> finished{false};
+	Race race(settings, [&](const RaceSnapshot& aSnapshot) {
+		if (aSnapshot->Finish && !finished.exchange(true)) {
+			++racesFinished;
+			LOGGER_LOG_FAST(PriorityEnum::Info, "soak: race finished, blue %llu red %llu",
+			                static_cast<unsigned long long>(aSnapshot->BlueScore),
+			                static_cast<unsigned long long>(aSnapshot->RedScore));
+		}
+	});
+	race.Init();
+	simulator.Start();
+
+	std::FILE* csv = options.CsvPath ? std::fopen(options.CsvPath, "w") : nullptr;
+	if (csv) {
+		std::fprintf(csv, "seconds,races");
+		for (const auto& metric : metrics) {
+			std::fprintf(csv, ",%s", metric.Name);
+		}
+		std::fprintf(csv, "\n");
+	}
+
+	const auto start = Clock::now();
+	const auto deadline = start + std::chrono::duration_cast<Clock::duration>(
+		std::chrono::duration<double>(options.DurationSeconds));
+	const auto sampleInterval = std::chrono::duration_cast<Clock::duration>(
+		std::chrono::duration<double>(options.SampleIntervalSeconds));
+	auto nextSample = start + sampleInterval;
+
+	finished = true;
+	while (!gStop && Clock::now() < deadline) {
+		if (finished) {
+			finished = false;
+			race.Start();
+		}
+
+		if (Clock::now() >= nextSample) {
+			nextSample += sampleInterval;
+			ProcessStats stats;
+			ProcessStats::Read(stats);
+			const double sent = static_cast<double>(simulator.GetSentCount(RacersEnum::BLUE) +
+			                                        simulator.GetSentCount(RacersEnum::RED));
+			const double received = static_cast<double>(race.GetPulseCount(RacersEnum::BLUE) +
+			                                            race.GetPulseCount(RacersEnum::RED));
+			double values[MetricCount];
+			values[ResidentBytes] = static_cast<double>(stats.ResidentBytes);
+			values[Threads] = stats.Threads;
+			values[OpenFiles] = stats.OpenFiles;
+			values[LogQueueSize] = static_cast<double>(Logger::Instance().GetCallbackQueueSize());
+			values[LogDropped] = static_cast<double>(Logger::Instance().GetCallbackDroppedCount() +
+			                                         BinaryLogger::Instance().GetDroppedCount());
+			values[PulseLag] = sent - received;
+
+			const double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+			if (csv) {
+				std::fprintf(csv, "%.1f,%llu", elapsed, static_cast<unsigned long long>(racesFinished));
+			}
+			for (size_t i = 0; i < MetricCount; ++i) {
+				metrics[i].Values.push_back(values[i]);
+				if (csv) {
+					std::fprintf(csv, ",%.0f", values[i]);
+				}
+			}
+			if (csv) {
+				std::fprintf(csv, "\n");
+				std::fflush(csv);
+			}
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	}
+
+	// сверка с имитатором: после остановки всё отправленное должно быть принято
+	simulator.Stop();
+	std::this_thread::sleep_for(std::chrono::seconds(1));
+	bool ok = true;
+	for (RacersEnum racer : {RacersEnum::BLUE, RacersEnum::RED}) {
+		const uint64_t sent = simulator.GetSentCount(racer);
+		const uint64_t received = race.GetPulseCount(racer);
+		std::fprintf(stderr, "%-16s sent %llu received %llu\n",
+		             racer == RacersEnum::BLUE ? "pulses blue" : "pulses red",
+		             static_cast<unsigned long long>(sent), static_cast<unsigned long long>(received));
+		ok = ok && sent == received;
+	}
+	std::fprintf(stderr, "races finished %llu\n", static_cast<unsigned long long>(racesFinished));
+
+	for (const auto& metric : metrics) {
+		ok = CheckTrend(metric) && ok;
+	}
+	if (csv) {
+		std::fclose(csv);
+	}
+
+	std::fprintf(stderr, "%s\n", ok ? "SOAK PASSED" : "SOAK FAILED");
+	return ok ? 0 : 1;
+}
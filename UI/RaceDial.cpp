@@ -0,0 +1,157 @@
+#include "./RaceDial.h"
+
+#include <QPaintEvent>
+#include <QPainter>
+
+#include <algorithm>
+#include <cmath>
+
+#include "Trace.h"
+
+namespace {
+const double Pi = 3.14159265358979323846;
+// Делений шкалы на оборот
+const int MajorTicks = 10;
+const int MinorTicksPerMajor = 5;
+// Длина стрелки относительно радиуса циферблата
+const double HandLength = 0.82;
+// Запас вокруг стрелки при вычислении перерисовываемой области, пиксели
+const int HandMargin = 3;
+}
+
+RaceDial::RaceDial(QWidget* parent) : QWidget(parent) {
+    // циферблат из кэша закрывает весь виджет, стирать фон перед отрисовкой не нужно
+    setAttribute(Qt::WA_OpaquePaintEvent);
+    setAttribute(Qt::WA_NoSystemBackground);
+    setWindowTitle("ГОЛДСПРИНТ");
+    setMinimumSize(200, 200);
+
+    mHands[BlueHand].Color = QColor(30, 90, 255);
+    mHands[RedHand].Color = QColor(235, 30, 30);
+}
+
+void RaceDial::SetFullScale(double aFullScale) {
+    if (aFullScale <= 0.0 || aFullScale == mFullScale) {
+        return;
+    }
+    mFullScale = aFullScale;
+    RenderFace();
+    for (auto& hand : mHands) {
+        hand.Rect = HandRect(hand.Value);
+    }
+    update();
+}
+
+void RaceDial::SetValues(double aBlue, double aRed) {
+    MoveHand(mHands[BlueHand], aBlue);
+    MoveHand(mHands[RedHand], aRed);
+}
+
+void RaceDial::MoveHand(Hand& aHand, double aValue) {
+    if (aHand.Value == aValue) {
+        return;
+    }
+    aHand.Value = aValue;
+    const QRect rect = HandRect(aValue);
+    if (rect == aHand.Rect) {
+        return;
+    }
+    // перерисовать только то место, где стрелка была, и то, где она теперь
+    update(QRegion(aHand.Rect) + QRegion(rect));
+    aHand.Rect = rect;
+}
+
+void RaceDial::resizeEvent(QResizeEvent* aEvent) {
+    QWidget::resizeEvent(aEvent);
+    RenderFace();
+    for (auto& hand : mHands) {
+        hand.Rect = HandRect(hand.Value);
+    }
+}
+
+QPointF RaceDial::HandTip(double aValue) const {
+    const double fraction = std::fmod(aValue / mFullScale, 1.0);
+    const double angle = fraction * 2.0 * Pi;
+    const double length = mRadius * HandLength;
+    return mCenter + QPointF(length * std::sin(angle), -length * std::cos(angle));
+}
+
+double RaceDial::HandWidth() const {
+    return std::max(3.0, mRadius * 0.03);
+}
+
+QRect RaceDial::HandRect(double aValue) const {
+    const int margin = static_cast<int>(std::ceil(HandWidth())) + HandMargin;
+    return QRectF(mCenter, HandTip(aValue)).normalized().toAlignedRect()
+        .adjusted(-margin, -margin, margin, margin);
+}
+
+void RaceDial::RenderFace() {
+    TRACE_SCOPE("UI", "RaceDial::RenderFace");
+    const qreal ratio = devicePixelRatioF();
+    mFace = QPixmap(size() * ratio);
+    mFace.setDevicePixelRatio(ratio);
+    mFace.fill(Qt::black);
+
+    mCenter = QPointF(width() / 2.0, height() / 2.0);
+    mRadius = std::min(width(), height()) / 2.0 * 0.95;
+
+    QPainter painter(&mFace);
+    painter.setRenderHint(QPainter::Antialiasing);
+
+    painter.setPen(QPen(QColor(220, 220, 220), std::max(2.0, mRadius * 0.02)));
+    painter.setBrush(QColor(250, 248, 240));
+    painter.drawEllipse(mCenter, mRadius, mRadius);
+
+    QFont font = painter.font();
+    font.setPixelSize(std::max(10, static_cast<int>(mRadius * 0.09)));
+    font.setBold(true);
+    painter.setFont(font);
+
+    const int ticks = MajorTicks * MinorTicksPerMajor;
+    for (int i = 0; i < ticks; ++i) {
+        const bool major = i % MinorTicksPerMajor == 0;
+        const double angle = 2.0 * Pi * i / ticks;
+        const QPointF direction(std::sin(angle), -std::cos(angle));
+        const double inner = mRadius * (major ? 0.86 : 0.91);
+        painter.setPen(QPen(Qt::black, major ? std::max(2.0, mRadius * 0.015) : 1.0));
+        painter.drawLine(mCenter + direction * inner, mCenter + direction * (mRadius * 0.96));
+
+        if (major) {
+            const QPointF textCenter = mCenter + direction * (mRadius * 0.74);
+            const QRectF textRect(textCenter - QPointF(mRadius * 0.15, mRadius * 0.06),
+                                  QSizeF(mRadius * 0.3, mRadius * 0.12));
+            painter.drawText(textRect, Qt::AlignCenter,
+                             QString::number(mFullScale * i / ticks, 'f', 0));
+        }
+    }
+}
+
+void RaceDial::paintEvent(QPaintEvent* aEvent) {
+    TRACE_SCOPE("UI", "RaceDial::paintEvent");
+    QPainter painter(this);
+    painter.setClipRegion(aEvent->region());
+
+    // циферблат копируется из кэша только в пределах перерисовываемой области
+    for (const QRect& rect : aEvent->region()) {
+        painter.drawPixmap(rect, mFace, QRectF(QPointF(rect.topLeft()) * mFace.devicePixelRatio(),
+                                               QSizeF(rect.size()) * mFace.devicePixelRatio()));
+    }
+
+    painter.setRenderHint(QPainter::Antialiasing);
+    for (const auto& hand : mHands) {
+        if (!aEvent->region().intersects(hand.Rect)) {
+            continue;
+        }
+        painter.setPen(QPen(hand.Color, HandWidth(), Qt::SolidLine, Qt::RoundCap));
+        painter.drawLine(mCenter, HandTip(hand.Value));
+    }
+
+    const double hub = HandWidth() * 1.5;
+    const QRectF hubRect(mCenter - QPointF(hub, hub), QSizeF(hub * 2.0, hub * 2.0));
+    if (aEvent->region().intersects(hubRect.toAlignedRect())) {
+        painter.setPen(Qt::NoPen);
+        painter.setBrush(Qt::black);
+        painter.drawEllipse(hubRect);
+    }
+}
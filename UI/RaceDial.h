@@ -0,0 +1,54 @@
+// Copyright 2018
+
+#ifndef RACE_DIAL_H_
+#define RACE_DIAL_H_
+
+#include <QPixmap>
+#include <QWidget>
+
+#include <array>
+
+
+// Классический циферблат голдспринта: по одной стрелке на гонщика.
+// Циферблат (шкала, риски, подписи) рисуется один раз в кэшированный QPixmap при изменении
+// размера или шкалы; при движении стрелок перерисовывается только область старого и нового
+// положения стрелки, поэтому полноэкранный вывод на проектор не требует перерисовки всего окна.
+class RaceDial : public QWidget {
+    Q_OBJECT
+
+public:
+    explicit RaceDial(QWidget* parent = nullptr);
+
+    // Значение, соответствующее полному обороту стрелки
+    void SetFullScale(double aFullScale);
+    // Пройденная дистанция по дорожкам (в единицах шкалы)
+    void SetValues(double aBlue, double aRed);
+
+protected:
+    void paintEvent(QPaintEvent* aEvent) override;
+    void resizeEvent(QResizeEvent* aEvent) override;
+
+private:
+    enum { BlueHand, RedHand, HandCount };
+
+    struct Hand {
+        QColor Color;
+        double Value = 0.0;
+        QRect Rect;
+    };
+
+    std::array<Hand, HandCount> mHands;
+    // По умолчанию (гонка на время) - метров на оборот
+    double mFullScale = 1000.0;
+    QPixmap mFace;
+    QPointF mCenter;
+    double mRadius = 0.0;
+
+    void RenderFace();
+    void MoveHand(Hand& aHand, double aValue);
+    QPointF HandTip(double aValue) const;
+    QRect HandRect(double aValue) const;
+    double HandWidth() const;
+};
+
+#endif // RACE_DIAL_H_
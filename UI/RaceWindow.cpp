@@ -1,26 +1,118 @@
 ﻿#include "./RaceWindow.h"
 #include "Core/Settings.h"
+#include "Trace.h"
+#include <QGuiApplication>
+#include <QScreen>
+#include <QShortcut>
+#include <algorithm>
 #include <functional>
 
-RaceWindow::RaceWindow(QWidget* parent) : QMainWindow(parent), mLogger(Fatracing::Logger::Instance()) {
+namespace {
+// Период обновления оверлея задержки
+const std::chrono::milliseconds LatencyOverlayPeriod(250);
+
+double ToMilliseconds(uint64_t aMicroseconds) {
+    return aMicroseconds / 1000.0;
+}
+
+// Частота обновления, если экран её не сообщает
+const qreal DefaultRefreshRate = 60.0;
+
+template <typename T>
+bool Changed(T& aDisplayed, const T& aValue) {
+    if (aDisplayed == aValue) {
+        return false;
+    }
+    aDisplayed = aValue;
+    return true;
+}
+}
+
+RaceWindow::RaceWindow(QWidget* parent) :
+    QMainWindow(parent),
+    mLogger(Fatracing::Logger::Instance()),
+    mLatencyMetric(Fatracing::Metrics::Instance().AddHistogram("fatracing_frame_latency_seconds",
+                                                               "Time from pulse arrival to the frame showing it",
+                                                               Fatracing::Metrics::LatencyBounds())) {
     ui.setupUi(this);
+    Fatracing::Tracer::Instance().SetThreadName("GUI");
 
     connect(ui.pushButtonStart, &QPushButton::clicked, this, &RaceWindow::OnPushButtonStart);
-    connect(this, &RaceWindow::RaceSignal, this, &RaceWindow::RaceSlot, Qt::QueuedConnection);
+    connect(this, &RaceWindow::FrameRequested, this, &RaceWindow::OnFrameRequested, Qt::QueuedConnection);
+
+    qreal refreshRate = DefaultRefreshRate;
+    if (QGuiApplication::primaryScreen() && QGuiApplication::primaryScreen()->refreshRate() > 1.0) {
+        refreshRate = QGuiApplication::primaryScreen()->refreshRate();
+    }
+    mFrameInterval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(1.0 / refreshRate));
+    mFrameTimer.setSingleShot(true);
+    mFrameTimer.setTimerType(Qt::PreciseTimer);
+    connect(&mFrameTimer, &QTimer::timeout, this, &RaceWindow::RenderFrame);
+
+    mLatencyOverlay = new QLabel(this);
+    mLatencyOverlay->setStyleSheet("background-color: rgba(0, 0, 0, 160); color: white; padding: 4px;");
+    mLatencyOverlay->setAttribute(Qt::WA_TransparentForMouseEvents);
+    mLatencyOverlay->move(4, 4);
+    mLatencyOverlay->hide();
+    auto latencyShortcut = new QShortcut(QKeySequence(Qt::Key_F3), this);
+    connect(latencyShortcut, &QShortcut::activated, this, &RaceWindow::OnToggleLatencyOverlay);
+    UpdateLatencyOverlay();
+
+    mSpeedChart = new SpeedChart(this);
+    mSpeedChart->setMinimumHeight(160);
+    ui.verticalLayout_8->addWidget(mSpeedChart);
+
+    mRaceDial = new RaceDial(this);
+    mRaceDial->setWindowFlags(Qt::Window);
+    auto raceDialShortcut = new QShortcut(QKeySequence(Qt::Key_F2), this);
+    connect(raceDialShortcut, &QShortcut::activated, this, &RaceWindow::OnToggleRaceDial);
 
     auto s = Fatracing::SettingsSingleton::Instance().GetSettings();
+    mRaceTimeSeconds = s.RaceTimeSeconds;
+    mCountdownSeconds = std::max(s.CountdownSeconds, 0);
+    mDistanceRace = s.RaceDistanceMeters > 0.0;
+    for (size_t lane = 0; lane < mMetersPerPulse.size(); ++lane) {
+        mMetersPerPulse[lane] = s.Lanes[lane].MetersPerPulse();
+    }
+    // гонка на дистанцию: полный круг циферблата - дистанция (у дорожек может быть разная передача)
+    if (mDistanceRace) {
+        mRaceDial->SetFullScale(s.RaceDistanceMeters);
+    }
     mRace = std::make_shared<Fatracing::Race>(s, std::bind(&RaceWindow::RaceCallback, this, std::placeholders::_1));
     mRace->Init();
-
-	qRegisterMetaType<Fatracing::RaceStruct>();
 }
 
 RaceWindow::~RaceWindow() {
+    // потоки BlackBox и таймера гонки вызывают RaceCallback (this): останавливаем их до разрушения остальных членов
+    mRace.reset();
+}
 
+void RaceWindow::RaceCallback(const Fatracing::RaceSnapshot&) {
+    // снимок уже опубликован в Race, здесь ничего не копируется;
+    // состояния между кадрами схлопываются: в очередь Qt уходит не больше одного запроса на кадр
+    if (!mFrameRequested.exchange(true)) {
+        TRACE_INSTANT("UI", "FrameRequested");
+        emit FrameRequested();
+    }
 }
 
-void RaceWindow::RaceCallback(Fatracing::RaceStruct aRaceStruct) {
-    emit RaceSignal(aRaceStruct);
+void RaceWindow::OnFrameRequested() {
+    if (mFrameTimer.isActive()) {
+        return;
+    }
+    const auto elapsed = std::chrono::steady_clock::now() - mLastFrameTime;
+    const auto wait = std::max(mFrameInterval - elapsed, std::chrono::steady_clock::duration::zero());
+    mFrameTimer.start(static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(wait).count()));
+}
+
+void RaceWindow::RenderFrame() {
+    mLastFrameTime = std::chrono::steady_clock::now();
+    mFrameRequested = false;
+    const auto snapshot = mRace->GetSnapshot();
+    if (snapshot) {
+        Render(*snapshot);
+    }
 }
 
 void RaceWindow::OnPushButtonStart() {
@@ -28,42 +120,170 @@ void RaceWindow::OnPushButtonStart() {
     ui.lineEditBlue->setEnabled(false);
     ui.lineEditRed->setEnabled(false);
 
+    mLatency.Reset();
+    mLatencyLogged = false;
+    UpdateLatencyOverlay();
+    mSpeedChart->Start(mRaceTimeSeconds);
+    // график скорости идёт от сигнала старта, а не от нажатия кнопки
+    mRaceStartTime = std::chrono::steady_clock::now() + std::chrono::seconds(mCountdownSeconds);
+    mRaceRunning = true;
     mRace->Start();
 }
 
-void RaceWindow::RaceSlot(Fatracing::RaceStruct aRaceStruct) {
-    QString seconds = "0:";
-    ui.labelSeconds->setText(seconds + QString::number(aRaceStruct.Seconds));
+void RaceWindow::OnToggleLatencyOverlay() {
+    mLatencyOverlay->setVisible(!mLatencyOverlay->isVisible());
+    if (mLatencyOverlay->isVisible()) {
+        UpdateLatencyOverlay();
+        mLatencyOverlay->raise();
+    }
+}
+
+void RaceWindow::OnToggleRaceDial() {
+    if (mRaceDial->isVisible()) {
+        mRaceDial->hide();
+        return;
+    }
+    // если подключён второй экран (проектор), циферблат открывается на нём во весь экран
+    const auto screens = QGuiApplication::screens();
+    if (screens.size() > 1) {
+        mRaceDial->setGeometry(screens.back()->geometry());
+        mRaceDial->showFullScreen();
+    } else {
+        mRaceDial->resize(720, 720);
+        mRaceDial->show();
+    }
+}
+
+void RaceWindow::Render(const Fatracing::RaceStruct& aRaceStruct) {
+    TRACE_SCOPE("UI", "Render");
+    if (Changed(mDisplayed.Seconds, aRaceStruct.Seconds)) {
+        ui.labelSeconds->setText(QString("0:") + QString::number(aRaceStruct.Seconds));
+    }
 
-    ui.labelBlueScore->setText(QString::number(aRaceStruct.BlueScore));
-    ui.labelRedScore->setText(QString::number(aRaceStruct.RedScore));
+    // обратный отсчёт и фальстарты - на месте лидера, до первого импульса обеих дорожек
+    const int falseStarts = (aRaceStruct.Starts[static_cast<size_t>(Fatracing::RacersEnum::BLUE)].FalseStart ? 1 : 0) |
+                            (aRaceStruct.Starts[static_cast<size_t>(Fatracing::RacersEnum::RED)].FalseStart ? 2 : 0);
+    if (Changed(mDisplayed.Countdown, aRaceStruct.Countdown) | Changed(mDisplayed.FalseStarts, falseStarts)) {
+        if (aRaceStruct.Countdown > 0) {
+            ui.labelLeader->setText(QString("<span style=\"font-size:30pt;\">%1</span>").arg(aRaceStruct.Countdown));
+        } else if (falseStarts != 0) {
+            ui.labelLeader->setText(QString("<span style=\"font-size:30pt;\">ФАЛЬСТАРТ%1%2</span>")
+                                    .arg(QString(falseStarts & 1 ? " BLUE" : "")).arg(QString(falseStarts & 2 ? " RED" : "")));
+        } else {
+            ui.labelLeader->clear();
+        }
+        mDisplayed.Leader = -1;
+    }
+
+    if (Changed(mDisplayed.BlueScore, aRaceStruct.BlueScore)) {
+        ui.labelBlueScore->setText(QString::number(aRaceStruct.BlueScore));
+    }
+    if (Changed(mDisplayed.RedScore, aRaceStruct.RedScore)) {
+        ui.labelRedScore->setText(QString::number(aRaceStruct.RedScore));
+    }
 
-    ui.labelBlueRPM->setText(QString::number(aRaceStruct.BlueRPM));
-    ui.labelRedRPM->setText(QString::number(aRaceStruct.RedRPM));
+    if (Changed(mDisplayed.BlueRPM, aRaceStruct.BlueRPM)) {
+        ui.labelBlueRPM->setText(QString::number(aRaceStruct.BlueRPM));
+    }
+    if (Changed(mDisplayed.RedRPM, aRaceStruct.RedRPM)) {
+        ui.labelRedRPM->setText(QString::number(aRaceStruct.RedRPM));
+    }
 
-    if (aRaceStruct.Finish) {
+    if (Changed(mDisplayed.Finish, aRaceStruct.Finish) && aRaceStruct.Finish) {
         ui.lineEditBlue->setText(QString::number(aRaceStruct.BlueScore));
         ui.lineEditRed->setText(QString::number(aRaceStruct.RedScore));
+    }
+    // результат фотофиниша: время финиша или метры с долями импульса, следующая гонка - только после него
+    if (Changed(mDisplayed.ResultsFinal, aRaceStruct.ResultsFinal) && aRaceStruct.ResultsFinal) {
+        const auto resultText = [&](Fatracing::RacersEnum aRacer) {
+            const auto& result = aRaceStruct.Results[static_cast<size_t>(aRacer)];
+            const auto& start = aRaceStruct.Starts[static_cast<size_t>(aRacer)];
+            QString text = mDistanceRace && result.FinishTimeUs >= 0 ?
+                           QString("%1 с (%2)").arg(result.FinishTimeUs / 1e6, 0, 'f', 6).arg(result.Place) :
+                           QString("%1 м (%2)").arg(result.Meters, 0, 'f', 3).arg(result.Place);
+            if (start.FalseStart) {
+                text += " ФАЛЬСТАРТ";
+            } else if (start.ReactionUs >= 0) {
+                text += QString(", реакция %1 мс").arg(start.ReactionUs / 1e3, 0, 'f', 3);
+            }
+            return text;
+        };
+        ui.lineEditBlue->setText(resultText(Fatracing::RacersEnum::BLUE));
+        ui.lineEditRed->setText(resultText(Fatracing::RacersEnum::RED));
         ui.pushButtonStart->setEnabled(true);
         ui.lineEditBlue->setEnabled(true);
         ui.lineEditRed->setEnabled(true);
     }
 
     if (aRaceStruct.BlueScore != 0 && aRaceStruct.RedScore != 0) {
-        switch (aRaceStruct.Leader) {
-        case Fatracing::RacersEnum::BLUE: {
-            ui.labelLeader->setText("<span style=\"font-size:30pt; color:blue;\">BLUE</span>");
-            break;
-        }
-        case Fatracing::RacersEnum::RED: {
-            //ui.labelLeader->setText("RED");
-            ui.labelLeader->setText("<span style=\"font-size:30pt; color:red;\">RED</span>");
-            break;
+        if (Changed(mDisplayed.Leader, static_cast<int>(aRaceStruct.Leader))) {
+            switch (aRaceStruct.Leader) {
+            case Fatracing::RacersEnum::BLUE: {
+                ui.labelLeader->setText("<span style=\"font-size:30pt; color:blue;\">BLUE</span>");
+                break;
+            }
+            case Fatracing::RacersEnum::RED: {
+                //ui.labelLeader->setText("RED");
+                ui.labelLeader->setText("<span style=\"font-size:30pt; color:red;\">RED</span>");
+                break;
+            }
+            }
         }
+
+        if (Changed(mDisplayed.Diff, aRaceStruct.Diff)) {
+            // отрыв в метрах
+            ui.labelDiff->setText(QString::number(aRaceStruct.Diff, 'f', 1));
         }
+    }
+
+    mRaceDial->SetValues(aRaceStruct.BlueScore * mMetersPerPulse[static_cast<size_t>(Fatracing::RacersEnum::BLUE)],
+                         aRaceStruct.RedScore * mMetersPerPulse[static_cast<size_t>(Fatracing::RacersEnum::RED)]);
+
+    if (mRaceRunning && aRaceStruct.Countdown == 0 && mLastFrameTime >= mRaceStartTime) {
+        mSpeedChart->AddSample(mLastFrameTime - mRaceStartTime, aRaceStruct.BlueScore, aRaceStruct.RedScore);
+        mRaceRunning = !aRaceStruct.Finish;
+    }
+
+    RecordLatency(aRaceStruct);
+    if (aRaceStruct.Finish && !mLatencyLogged) {
+        mLatencyLogged = true;
+        LogLatency();
+    }
+}
+
+void RaceWindow::RecordLatency(const Fatracing::RaceStruct& aRaceStruct) {
+    if (aRaceStruct.PulseTime == std::chrono::steady_clock::time_point()) {
+        return;
+    }
+    const auto now = std::chrono::steady_clock::now();
+    mLatency.Record(now - aRaceStruct.PulseTime);
+    mLatencyMetric.Observe(now - aRaceStruct.PulseTime);
+
+    if (mLatencyOverlay->isVisible() && now - mLatencyOverlayUpdateTime >= LatencyOverlayPeriod) {
+        mLatencyOverlayUpdateTime = now;
+        UpdateLatencyOverlay();
+    }
+}
+
+void RaceWindow::UpdateLatencyOverlay() {
+    mLatencyOverlay->setText(QString("pulse→pixel  n=%1\np50 %2 ms  p99 %3 ms  max %4 ms")
+        .arg(mLatency.Count())
+        .arg(ToMilliseconds(mLatency.PercentileUs(50)), 0, 'f', 2)
+        .arg(ToMilliseconds(mLatency.PercentileUs(99)), 0, 'f', 2)
+        .arg(ToMilliseconds(mLatency.MaxUs()), 0, 'f', 2));
+    mLatencyOverlay->adjustSize();
+}
 
-        ui.labelDiff->setText(QString::number(aRaceStruct.Diff));
+void RaceWindow::LogLatency() {
+    UpdateLatencyOverlay();
+    if (mLatency.Count() == 0) {
+        return;
     }
+    LOGGER_LOG(Fatracing::PriorityEnum::Info, "Задержка импульс-экран за гонку: p50 %.2f мс, p99 %.2f мс, max %.2f мс (импульсов: %llu)",
+               ToMilliseconds(mLatency.PercentileUs(50)),
+               ToMilliseconds(mLatency.PercentileUs(99)),
+               ToMilliseconds(mLatency.MaxUs()),
+               static_cast<unsigned long long>(mLatency.Count()));
 }
 
 
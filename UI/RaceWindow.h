@@ -3,18 +3,25 @@
 
 #include <QMainWindow>
 #include <QGraphicsScene>
+#include <QLabel>
+#include <QTimer>
 
+#include <array>
+#include <atomic>
+#include <cstdint>
 #include <memory>
 
+#include "LatencyHistogram.h"
 #include "Logger.h"
+#include "Metrics.h"
 
 #include "Core/Race.h"
+#include "./RaceDial.h"
+#include "./SpeedChart.h"
 
 #include "ui_racewindow.h"
 
 
-Q_DECLARE_METATYPE(Fatracing::RaceStruct)
-
 class RaceWindow : public QMainWindow {
 	Q_OBJECT
 
@@ -27,14 +34,64 @@ private:
 
     Ui_RaceWindow ui;
 
-    void RaceCallback(Fatracing::RaceStruct);
+    // Потоки Race только взводят флаг, последний снимок забирается через Race::GetSnapshot раз в кадр
+    std::atomic<bool> mFrameRequested{false};
+
+    // Отрисовка не чаще частоты обновления монитора
+    QTimer mFrameTimer;
+    std::chrono::steady_clock::duration mFrameInterval;
+    std::chrono::steady_clock::time_point mLastFrameTime;
+
+    // То, что сейчас показано на экране, чтобы обновлять только изменившиеся виджеты
+    struct DisplayedState {
+        int Seconds = -1;
+        uint64_t BlueScore = UINT64_MAX;
+        uint64_t RedScore = UINT64_MAX;
+        uint64_t BlueRPM = UINT64_MAX;
+        uint64_t RedRPM = UINT64_MAX;
+        int Leader = -1;
+        double Diff = -1.0;
+        bool Finish = false;
+        bool ResultsFinal = false;
+        int Countdown = -1;
+        // Биты фальстартов: 1 - синий, 2 - красный
+        int FalseStarts = -1;
+    };
+    DisplayedState mDisplayed;
+
+    SpeedChart* mSpeedChart = nullptr;
+    // Отдельное окно с циферблатом для зрителей (проектор)
+    RaceDial* mRaceDial = nullptr;
+    int mRaceTimeSeconds = 0;
+    int mCountdownSeconds = 0;
+    bool mDistanceRace = false;
+    // Метров на импульс по дорожкам: стрелки циферблата показывают метры
+    std::array<double, 2> mMetersPerPulse{{0.0, 0.0}};
+    bool mRaceRunning = false;
+    std::chrono::steady_clock::time_point mRaceStartTime;
+
+    // Задержка импульс-экран за текущую гонку
+    Fatracing::LatencyHistogram mLatency;
+    Fatracing::MetricHistogram& mLatencyMetric;
+    bool mLatencyLogged = false;
+    QLabel* mLatencyOverlay = nullptr;
+    std::chrono::steady_clock::time_point mLatencyOverlayUpdateTime;
+
+    void RaceCallback(const Fatracing::RaceSnapshot&);
+    void Render(const Fatracing::RaceStruct& aRaceStruct);
+    void RecordLatency(const Fatracing::RaceStruct& aRaceStruct);
+    void UpdateLatencyOverlay();
+    void LogLatency();
 
 signals:
-    void RaceSignal(Fatracing::RaceStruct);
+    void FrameRequested();
 
 private slots:
     void OnPushButtonStart();
-    void RaceSlot(Fatracing::RaceStruct);
+    void OnToggleLatencyOverlay();
+    void OnToggleRaceDial();
+    void OnFrameRequested();
+    void RenderFrame();
 };
 
 #endif // RACE_WINDOW_H_
@@ -0,0 +1,171 @@
+#include "./SpeedChart.h"
+
+#include <QPainter>
+#include <QResizeEvent>
+
+#include <algorithm>
+#include <cmath>
+
+#include "Trace.h"
+
+namespace {
+// Ёмкость истории отсчётов (при 10 Гц хватает на ~7 минут)
+const size_t HistoryCapacity = 4096;
+// Минимальный интервал между отсчётами, с
+const double SampleInterval = 0.1;
+// Окно, по которому считается каденс, с
+const double RpmWindow = 1.0;
+// Сегментов линии в одном куске
+const int ChunkSize = 16;
+// Начальный масштаб по вертикали, об/мин
+const double InitialMaxRpm = 200.0;
+// Шаг сетки по горизонтали, с
+const double TimeGridStep = 10.0;
+}
+
+SpeedChart::SpeedChart(QWidget* parent) : QGraphicsView(parent), mSamples(HistoryCapacity) {
+    setScene(&mScene);
+    setRenderHint(QPainter::Antialiasing);
+    setCacheMode(QGraphicsView::CacheBackground);
+    setViewportUpdateMode(QGraphicsView::MinimalViewportUpdate);
+    setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+    setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+    setFrameShape(QFrame::NoFrame);
+    setInteractive(false);
+    mScene.setItemIndexMethod(QGraphicsScene::NoIndex);
+
+    mBlue.Pen = QPen(QColor(Qt::blue), 2);
+    mBlue.Pen.setCosmetic(true);
+    mRed.Pen = QPen(QColor(Qt::red), 2);
+    mRed.Pen.setCosmetic(true);
+
+    Start(static_cast<int>(mRaceTime));
+}
+
+SpeedChart::~SpeedChart() {
+    ClearLane(mBlue);
+    ClearLane(mRed);
+}
+
+void SpeedChart::Start(int aRaceTimeSeconds) {
+    mSamples.Clear();
+    ClearLane(mBlue);
+    ClearLane(mRed);
+    mRaceTime = std::max(aRaceTimeSeconds, 1);
+    mMaxRpm = InitialMaxRpm;
+    UpdateSceneRect();
+}
+
+void SpeedChart::AddSample(std::chrono::steady_clock::duration aElapsed, uint64_t aBlueScore, uint64_t aRedScore) {
+    Sample sample;
+    sample.Time = std::chrono::duration<double>(aElapsed).count();
+    sample.BlueScore = aBlueScore;
+    sample.RedScore = aRedScore;
+    if (!mSamples.Empty() && sample.Time - mSamples.Back().Time < SampleInterval) {
+        return;
+    }
+    TRACE_SCOPE("UI", "SpeedChart::AddSample");
+    mSamples.Push(sample);
+
+    // самый новый отсчёт, отстоящий от текущего не меньше чем на окно
+    size_t from = mSamples.Size() - 1;
+    while (from > 0 && sample.Time - mSamples[from].Time < RpmWindow) {
+        --from;
+    }
+    const Sample& base = mSamples[from];
+    const double dt = sample.Time - base.Time;
+    const double blueRpm = dt > 0.0 ? (sample.BlueScore - base.BlueScore) * 60.0 / dt : 0.0;
+    const double redRpm = dt > 0.0 ? (sample.RedScore - base.RedScore) * 60.0 / dt : 0.0;
+
+    const double maxRpm = std::max(blueRpm, redRpm);
+    bool rescale = false;
+    while (maxRpm > mMaxRpm) {
+        mMaxRpm *= 2.0;
+        rescale = true;
+    }
+    if (sample.Time > mRaceTime) {
+        mRaceTime = std::ceil(sample.Time / TimeGridStep) * TimeGridStep;
+        rescale = true;
+    }
+    if (rescale) {
+        UpdateSceneRect();
+    }
+
+    // ось Y сцены направлена вниз, поэтому каденс откладывается со знаком минус
+    AppendPoint(mBlue, QPointF(sample.Time, -blueRpm));
+    AppendPoint(mRed, QPointF(sample.Time, -redRpm));
+}
+
+void SpeedChart::AppendPoint(Lane& aLane, const QPointF& aPoint) {
+    if (aLane.Chunks.empty()) {
+        aLane.Path = QPainterPath(aPoint);
+        aLane.ChunkSegments = 0;
+        aLane.Chunks.push_back(mScene.addPath(aLane.Path, aLane.Pen));
+        return;
+    }
+    if (aLane.ChunkSegments >= ChunkSize) {
+        // новый кусок начинается с последней точки предыдущего, старые куски больше не меняются
+        aLane.Path = QPainterPath(aLane.Path.currentPosition());
+        aLane.ChunkSegments = 0;
+        aLane.Chunks.push_back(mScene.addPath(aLane.Path, aLane.Pen));
+        if (aLane.Chunks.size() > HistoryCapacity / ChunkSize) {
+            delete aLane.Chunks.front();
+            aLane.Chunks.pop_front();
+        }
+    }
+    aLane.Path.lineTo(aPoint);
+    ++aLane.ChunkSegments;
+    aLane.Chunks.back()->setPath(aLane.Path);
+}
+
+void SpeedChart::ClearLane(Lane& aLane) {
+    for (auto item : aLane.Chunks) {
+        delete item;
+    }
+    aLane.Chunks.clear();
+    aLane.Path = QPainterPath();
+    aLane.ChunkSegments = 0;
+}
+
+void SpeedChart::UpdateSceneRect() {
+    const QRectF rect(0.0, -mMaxRpm, mRaceTime, mMaxRpm);
+    mScene.setSceneRect(rect);
+    fitInView(rect, Qt::IgnoreAspectRatio);
+    resetCachedContent();
+    viewport()->update();
+}
+
+void SpeedChart::resizeEvent(QResizeEvent* aEvent) {
+    QGraphicsView::resizeEvent(aEvent);
+    UpdateSceneRect();
+}
+
+void SpeedChart::drawBackground(QPainter* aPainter, const QRectF& aRect) {
+    aPainter->fillRect(aRect, QColor(24, 24, 24));
+
+    QPen gridPen(QColor(70, 70, 70), 1);
+    gridPen.setCosmetic(true);
+    aPainter->setPen(gridPen);
+
+    const double rpmStep = mMaxRpm / 4.0;
+    for (double rpm = rpmStep; rpm < mMaxRpm; rpm += rpmStep) {
+        aPainter->drawLine(QPointF(0.0, -rpm), QPointF(mRaceTime, -rpm));
+    }
+    for (double time = TimeGridStep; time < mRaceTime; time += TimeGridStep) {
+        aPainter->drawLine(QPointF(time, 0.0), QPointF(time, -mMaxRpm));
+    }
+
+    // подписи в координатах виджета, чтобы текст не растягивался вместе со сценой
+    aPainter->save();
+    aPainter->resetTransform();
+    aPainter->setPen(QColor(160, 160, 160));
+    for (double rpm = rpmStep; rpm < mMaxRpm; rpm += rpmStep) {
+        const QPoint point = mapFromScene(QPointF(0.0, -rpm));
+        aPainter->drawText(point + QPoint(4, -2), QString::number(rpm, 'f', 0));
+    }
+    for (double time = TimeGridStep; time < mRaceTime; time += TimeGridStep) {
+        const QPoint point = mapFromScene(QPointF(time, 0.0));
+        aPainter->drawText(point + QPoint(2, -4), QString::number(time, 'f', 0));
+    }
+    aPainter->restore();
+}
@@ -0,0 +1,64 @@
+// Copyright 2018
+
+#ifndef SPEED_CHART_H_
+#define SPEED_CHART_H_
+
+#include <QGraphicsPathItem>
+#include <QGraphicsScene>
+#include <QGraphicsView>
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+
+#include "RingBuffer.h"
+
+
+// График каденса (об/мин) по дорожкам за гонку.
+// Отсчёты копятся в кольцевом буфере фиксированной ёмкости, линия каждой дорожки
+// нарезана на короткие куски QGraphicsPathItem: новый отсчёт дописывается только в последний
+// кусок, поэтому перерисовывается лишь его небольшая область. Сетка рисуется в
+// drawBackground и кэшируется видом, так что стоимость кадра не растёт к концу гонки.
+class SpeedChart : public QGraphicsView {
+    Q_OBJECT
+
+public:
+    explicit SpeedChart(QWidget* parent = nullptr);
+    ~SpeedChart();
+
+    // Очистить график перед новой гонкой
+    void Start(int aRaceTimeSeconds);
+    // Добавить отсчёт: время от старта и накопленные импульсы по дорожкам
+    void AddSample(std::chrono::steady_clock::duration aElapsed, uint64_t aBlueScore, uint64_t aRedScore);
+
+protected:
+    void drawBackground(QPainter* aPainter, const QRectF& aRect) override;
+    void resizeEvent(QResizeEvent* aEvent) override;
+
+private:
+    struct Sample {
+        double Time = 0.0;
+        uint64_t BlueScore = 0;
+        uint64_t RedScore = 0;
+    };
+
+    struct Lane {
+        QPen Pen;
+        std::deque<QGraphicsPathItem*> Chunks;
+        QPainterPath Path;
+        int ChunkSegments = 0;
+    };
+
+    QGraphicsScene mScene;
+    Fatracing::RingBuffer<Sample> mSamples;
+    Lane mBlue;
+    Lane mRed;
+    double mRaceTime = 60.0;
+    double mMaxRpm = 0.0;
+
+    void AppendPoint(Lane& aLane, const QPointF& aPoint);
+    void ClearLane(Lane& aLane);
+    void UpdateSceneRect();
+};
+
+#endif // SPEED_CHART_H_
@@ -1,14 +1,40 @@
 #include <QtWidgets/QApplication>
+#include <cstdlib>
 //#include "UI/GoldSprintsFatracing.h"
 #include "UI/RaceWindow.h"
 #include "Core/Settings.h"
+#include "Metrics.h"
+#ifndef _WIN32
+#include "MetricsServer.h"
+#endif
+#include "Trace.h"
 
 
 int main(int argc, char *argv[]) {
+    Fatracing::Logger::Instance().InstallCrashHandlers();
+    // FATRACING_TRACE=<файл>: записать трассировку потоков в Chrome trace JSON
+    const char* traceFilePath = std::getenv("FATRACING_TRACE");
+    if (traceFilePath) {
+        Fatracing::Tracer::Instance().Start();
+    }
+#ifndef _WIN32
+    // FATRACING_METRICS=<порт>|127.0.0.1:<порт>|unix:<путь>: отдавать метрики в формате Prometheus
+    Fatracing::MetricsServer metricsServer;
+    const char* metricsAddress = std::getenv("FATRACING_METRICS");
+    if (metricsAddress) {
+        Fatracing::Metrics::Instance().RegisterProcessMetrics();
+        metricsServer.Start(metricsAddress);
+    }
+#endif
     Fatracing::SettingsSingleton::Instance().LoadSettings();
 	QApplication a(argc, argv);
     //GoldSprintsFatracing w;
     RaceWindow w;
     w.show();
-	return a.exec();
+	const int result = a.exec();
+    if (traceFilePath) {
+        Fatracing::Tracer::Instance().Stop();
+        Fatracing::Tracer::Instance().ExportChromeJson(traceFilePath);
+    }
+	return result;
 }